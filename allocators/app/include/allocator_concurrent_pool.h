@@ -0,0 +1,278 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+// Общий для всех потоков пул блоков одного размера.
+// Поток берет и возвращает блоки через свой локальный список без синхронизации.
+// Между потоками блоки ходят пачками по BatchSize через общий склад -
+// lock-free стек Treiber. Блок, освобожденный чужим потоком, попадает
+// в локальный список освобождающего потока, а излишек уходит на склад
+// целой пачкой, откуда его заберет любой поток.
+template <std::size_t BlockSize>
+class ConcurrentPool {
+public:
+    static constexpr std::size_t BatchSize = 64;          // блоков в пачке
+    static constexpr std::size_t BatchesPerChunk = 16;    // пачек в одном чанке
+
+private:
+    // Первый блок пачки хранит ссылку на следующую пачку склада и число блоков,
+    // остальные - только ссылку на следующий блок пачки
+    struct Block {
+        Block* next;
+        Block* nextBatch;
+        std::size_t count;
+    };
+
+    static_assert(BlockSize >= sizeof(Block), "Block is too small");
+    static_assert(BlockSize % alignof(std::max_align_t) == 0, "Block must keep max_align_t alignment");
+    static_assert(sizeof(void*) == 8, "Tagged depot head needs 64-bit pointers");
+
+    // Локальный список потока, при завершении потока уходит на склад
+    struct ThreadCache {
+        ConcurrentPool& pool;
+        Block* head = nullptr;
+        std::size_t count = 0;
+
+        explicit ThreadCache(ConcurrentPool& pool) : pool(pool) {}
+
+        ~ThreadCache() {
+            while (head) {
+                releaseBatch(count < BatchSize ? count : BatchSize);
+            }
+            cacheDestroyed() = true;
+        }
+
+        // отцепить первые n блоков и отдать их на склад одной пачкой
+        void releaseBatch(std::size_t n) {
+            Block* first = head;
+            Block* last = head;
+            for (std::size_t i = 1; i < n; ++i) {
+                last = last->next;
+            }
+            head = last->next;
+            last->next = nullptr;
+            count -= n;
+            pool.pushBatch(first, n);
+        }
+    };
+
+    // Вершина склада: указатель в младших 48 битах и счетчик в старших 16.
+    // Счетчик меняется при каждой операции, так что CAS со старой вершиной,
+    // которую успели снять и вернуть обратно (ABA), не проходит.
+    static constexpr unsigned TagShift = 48;
+    static constexpr std::uint64_t PointerMask = (std::uint64_t{1} << TagShift) - 1;
+
+    // заголовок чанка, блоки идут за ним с сохранением выравнивания
+    struct Chunk {
+        Chunk* next;
+    };
+    static constexpr std::size_t ChunkHeaderSize = alignof(std::max_align_t) > sizeof(Chunk) ? alignof(std::max_align_t) : sizeof(Chunk);
+
+    std::atomic<std::uint64_t> depot{0};
+    std::atomic<Chunk*> chunks{nullptr};
+    std::atomic<std::size_t> chunkTotal{0};
+
+    ConcurrentPool() = default;
+
+    static Block* pointer(std::uint64_t head) {
+        return reinterpret_cast<Block*>(static_cast<std::uintptr_t>(head & PointerMask));
+    }
+
+    static std::uint64_t pack(Block* batch, std::uint64_t head) {
+        const std::uint64_t tag = (head >> TagShift) + 1;
+        return (tag << TagShift) | (reinterpret_cast<std::uintptr_t>(batch) & PointerMask);
+    }
+
+    // Флаг без деструктора переживает кэш: после разрушения кэша потока
+    // (у главного потока - раньше статических объектов) блоки идут через склад
+    static bool& cacheDestroyed() {
+        static thread_local bool destroyed = false;
+        return destroyed;
+    }
+
+    ThreadCache* localCache() {
+        if (cacheDestroyed()) {
+            return nullptr;
+        }
+        static thread_local ThreadCache cache(*this);
+        return &cache;
+    }
+
+    void pushBatch(Block* batch, std::size_t count) {
+        batch->count = count;
+        std::uint64_t head = depot.load(std::memory_order_relaxed);
+        do {
+            batch->nextBatch = pointer(head);
+        } while (!depot.compare_exchange_weak(head, pack(batch, head),
+                                              std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    Block* popBatch() {
+        std::uint64_t head = depot.load(std::memory_order_acquire);
+        for (;;) {
+            Block* batch = pointer(head);
+            if (!batch) {
+                return nullptr;
+            }
+            // пачку могли уже снять и отдать пользователю - тогда прочитан мусор,
+            // но вершина сменилась и CAS не пройдет; чанки не освобождаются, чтение безопасно
+            Block* next = batch->nextBatch;
+            if (depot.compare_exchange_weak(head, pack(next, head),
+                                            std::memory_order_acquire, std::memory_order_acquire)) {
+                return batch;
+            }
+        }
+    }
+
+    // Новый чанк: первая пачка достается вызвавшему потоку, остальные - на склад.
+    // Потоки выделяют чанки независимо, без блокировки.
+    Block* allocateChunk() {
+        char* memory = static_cast<char*>(::operator new(ChunkHeaderSize + BlockSize * BatchSize * BatchesPerChunk));
+        // чанки связаны в список, чтобы оставаться достижимыми (LeakSanitizer не считает их утечкой)
+        Chunk* header = reinterpret_cast<Chunk*>(memory);
+        header->next = chunks.load(std::memory_order_relaxed);
+        while (!chunks.compare_exchange_weak(header->next, header, std::memory_order_release, std::memory_order_relaxed)) {
+        }
+        chunkTotal.fetch_add(1, std::memory_order_relaxed);
+
+        char* chunk = memory + ChunkHeaderSize;
+        Block* first = nullptr;
+        for (std::size_t b = 0; b < BatchesPerChunk; ++b) {
+            char* start = chunk + b * BatchSize * BlockSize;
+            for (std::size_t i = 0; i < BatchSize; ++i) {
+                Block* block = reinterpret_cast<Block*>(start + i * BlockSize);
+                block->next = i + 1 < BatchSize ? reinterpret_cast<Block*>(start + (i + 1) * BlockSize) : nullptr;
+            }
+            Block* batch = reinterpret_cast<Block*>(start);
+            if (b == 0) {
+                batch->count = BatchSize;
+                first = batch;
+            } else {
+                pushBatch(batch, BatchSize);
+            }
+        }
+        return first;
+    }
+
+public:
+    ConcurrentPool(const ConcurrentPool&) = delete;
+    ConcurrentPool& operator=(const ConcurrentPool&) = delete;
+
+    // Пул не разрушается: контейнеры со статическим временем жизни
+    // и потоки, завершающиеся после main, могут освобождать в него память
+    // и после разрушения своего кэша
+    static ConcurrentPool& instance() {
+        static ConcurrentPool* pool = new ConcurrentPool;
+        return *pool;
+    }
+
+    void* allocate() {
+        ThreadCache* cache = localCache();
+        if (!cache) {
+            // кэша уже нет: берем пачку со склада, остаток возвращаем обратно
+            Block* batch = popBatch();
+            if (!batch) {
+                batch = allocateChunk();
+            }
+            if (batch->count > 1) {
+                pushBatch(batch->next, batch->count - 1);
+            }
+            return batch;
+        }
+        if (!cache->head) {
+            Block* batch = popBatch();
+            if (!batch) {
+                batch = allocateChunk();
+            }
+            cache->head = batch;
+            cache->count = batch->count;
+        }
+        Block* block = cache->head;
+        cache->head = block->next;
+        --cache->count;
+        return block;
+    }
+
+    void deallocate(void* p) {
+        ThreadCache* cache = localCache();
+        Block* block = static_cast<Block*>(p);
+        if (!cache) {
+            // кэша уже нет: блок уходит на склад пачкой из одного
+            block->next = nullptr;
+            pushBatch(block, 1);
+            return;
+        }
+        block->next = cache->head;
+        cache->head = block;
+        // одну пачку оставляем себе, чтобы чередование allocate/deallocate на границе не гоняло пачки через склад
+        if (++cache->count >= 2 * BatchSize) {
+            cache->releaseBatch(BatchSize);
+        }
+    }
+
+    // Сколько чанков выделено за все время
+    std::size_t chunkCount() const {
+        return chunkTotal.load(std::memory_order_relaxed);
+    }
+};
+
+// Потокобезопасный аллокатор по одному объекту поверх ConcurrentPool.
+// Пул общий для всех типов с одинаковым размером блока, поэтому все экземпляры
+// равны: память, выделенную в одном потоке, можно освободить в другом.
+template <typename T>
+class ConcurrentPoolAllocator {
+    static_assert(alignof(T) <= alignof(std::max_align_t), "Over-aligned types are not supported");
+
+    static constexpr std::size_t roundUp(std::size_t size) {
+        const std::size_t align = alignof(std::max_align_t);
+        return (size + align - 1) / align * align;
+    }
+
+public:
+    using value_type = T;
+    // размер блока не меньше заголовка пачки
+    static constexpr std::size_t BlockSize = roundUp(sizeof(T) > 3 * sizeof(void*) ? sizeof(T) : 3 * sizeof(void*));
+    using Pool = ConcurrentPool<BlockSize>;
+
+    ConcurrentPoolAllocator() noexcept = default;
+
+    template <typename U>
+    ConcurrentPoolAllocator(const ConcurrentPoolAllocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        if (n != 1) throw std::bad_alloc(); // только по одному объекту
+        return static_cast<T*>(Pool::instance().allocate());
+    }
+
+    void deallocate(T* p, std::size_t) {
+        Pool::instance().deallocate(p);
+    }
+
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+        new (p) U(std::forward<Args>(args)...);
+    }
+
+    template <typename U>
+    void destroy(U* p) {
+        p->~U();
+    }
+
+    template <typename U>
+    struct rebind {
+        using other = ConcurrentPoolAllocator<U>;
+    };
+
+    // Сколько чанков выделено в общем пуле
+    std::size_t chunkCount() const { return Pool::instance().chunkCount(); }
+};
+
+template <typename T, typename U>
+bool operator==(const ConcurrentPoolAllocator<T>&, const ConcurrentPoolAllocator<U>&) { return true; }
+
+template <typename T, typename U>
+bool operator!=(const ConcurrentPoolAllocator<T>&, const ConcurrentPoolAllocator<U>&) { return false; }
@@ -1,90 +1,178 @@
 #pragma once
-#include <iostream>
+#include <cstddef>
 #include <memory>
+#include <new>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
-template <typename T, size_t Capacity>
-class FixedAllocator {
+// Capacity ячеек одного размера и выравнивания в одном куске памяти.
+// Освобожденные ячейки уходят в список свободных и выдаются снова,
+// так что при постоянном числе живых элементов память не кончается.
+class FixedSlotPool {
 public:
-    using value_type = T;
+    FixedSlotPool(std::size_t slotSize, std::size_t alignment, std::size_t capacity)
+        : slotSize(slotSize), alignment(alignment), capacity(capacity),
+          memory(static_cast<char*>(::operator new(slotSize * capacity, std::align_val_t(alignment)))) {}
+
+    ~FixedSlotPool() {
+        ::operator delete(memory, std::align_val_t(alignment));
+    }
+
+    FixedSlotPool(const FixedSlotPool&) = delete;
+    FixedSlotPool& operator=(const FixedSlotPool&) = delete;
 
-    FixedAllocator() : memory(nullptr), count(0) {
-        // Выделяем выровненную память для Capacity элементов типа T
-        memory = static_cast<T*>(std::aligned_alloc(alignof(T), sizeof(T) * Capacity));
-        if (!memory) {
-            throw std::bad_alloc();
+    // Одна ячейка берется из списка свободных, n подряд - только из еще не выданного хвоста
+    void* allocate(std::size_t n) {
+        if (n == 1 && freeList) {
+            Slot* slot = freeList;
+            freeList = slot->next;
+            --freeCount;
+            return slot;
         }
+        if (n > capacity - used) {
+            throw std::bad_alloc();  // Превышена вместимость аллокатора
+        }
+        void* result = memory + used * slotSize;
+        used += n;
+        return result;
     }
 
-    ~FixedAllocator() {
-        ::operator delete(memory);
+    // n подряд идущих ячеек возвращаются по одной
+    void deallocate(void* p, std::size_t n) noexcept {
+        char* start = static_cast<char*>(p);
+        for (std::size_t i = 0; i < n; ++i) {
+            Slot* slot = reinterpret_cast<Slot*>(start + i * slotSize);
+            slot->next = freeList;
+            freeList = slot;
+        }
+        freeCount += n;
+    }
+
+    bool fits(std::size_t size, std::size_t align) const {
+        return slotSize == size && alignment == align;
     }
 
+    // Сколько ячеек еще можно выделить
+    std::size_t available() const { return capacity - used + freeCount; }
+
+private:
+    struct Slot {
+        Slot* next;
+    };
+
+    std::size_t slotSize;
+    std::size_t alignment;
+    std::size_t capacity;
+    char* memory;
+    std::size_t used = 0;         // ячеек выдано из хвоста
+    Slot* freeList = nullptr;
+    std::size_t freeCount = 0;
+};
+
+// Пулы контейнера: по одному на каждый размер ячейки, с которым к нему
+// обращались. Контейнер выделяет память под узлы, а не под value_type,
+// поэтому пул заводится при первом выделении.
+class FixedArena {
+public:
+    explicit FixedArena(std::size_t capacity) : capacity(capacity) {}
+
+    FixedSlotPool& pool(std::size_t slotSize, std::size_t alignment) {
+        for (auto& pool : pools) {
+            if (pool->fits(slotSize, alignment)) {
+                return *pool;
+            }
+        }
+        pools.push_back(std::make_unique<FixedSlotPool>(slotSize, alignment, capacity));
+        return *pools.back();
+    }
+
+private:
+    std::size_t capacity;
+    std::vector<std::unique_ptr<FixedSlotPool>> pools;
+};
+
+// Аллокатор на Capacity объектов. Копии и rebind-копии делят арену и равны
+// между собой. Копия контейнера получает свою арену, перемещение и swap
+// забирают арену вместе с элементами.
+template <typename T, size_t Capacity>
+class FixedAllocator {
+    template <typename U, size_t C>
+    friend class FixedAllocator;
+
+    // ячейка вмещает и T, и ссылку списка свободных
+    static constexpr std::size_t SlotAlign = alignof(T) > alignof(void*) ? alignof(T) : alignof(void*);
+    static constexpr std::size_t SlotSize =
+        ((sizeof(T) > sizeof(void*) ? sizeof(T) : sizeof(void*)) + SlotAlign - 1) / SlotAlign * SlotAlign;
+
+    std::shared_ptr<FixedArena> arena;
+    FixedSlotPool* slots = nullptr;   // пул для T, ищется при первом обращении
+
+    FixedSlotPool& pool() {
+        if (!slots) {
+            slots = &arena->pool(SlotSize, SlotAlign);
+        }
+        return *slots;
+    }
+
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::false_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    FixedAllocator() : arena(std::make_shared<FixedArena>(Capacity)) {}
+
+    // Перемещение тоже копирует: аллокатор-источник должен остаться рабочим
+    FixedAllocator(const FixedAllocator&) noexcept = default;
+    FixedAllocator& operator=(const FixedAllocator&) noexcept = default;
+
+    template <typename U>
+    FixedAllocator(const FixedAllocator<U, Capacity>& other) noexcept : arena(other.arena) {}
+
     template <typename U>
     struct rebind {
         using other = FixedAllocator<U, Capacity>;
     };
 
+    FixedAllocator select_on_container_copy_construction() const {
+        return FixedAllocator();
+    }
+
     T *allocate(std::size_t n) {
-        //std::cout << "allocate \n";
-        if (n + count > Capacity) {
-            throw std::bad_alloc();  // Превышина вместимость аллокатора
-        }
-        T *result = memory + count;
-        count += n;
-        return result;
+        return static_cast<T*>(pool().allocate(n));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept {
+        pool().deallocate(p, n);
     }
 
     template <typename U, typename... Args>
     void construct(U* p, Args&&... args) {
-        //std::cout << "construct \n";
-        new (p) U(std::forward<Args>(args)...); 
+        new (p) U(std::forward<Args>(args)...);
     }
 
     template <typename U>
     void destroy(U* p) {
-       // std::cout << "destroy \n";
-        p->~U(); 
+        p->~U();
     }
 
-    void deallocate(T* p, std::size_t n) {
-        // удад
-    }
-
-    FixedAllocator(const FixedAllocator&) = delete;
-    FixedAllocator& operator=(const FixedAllocator&) = delete;
-
-    FixedAllocator(FixedAllocator&& other) noexcept : memory(other.memory), count(other.count) {
-        std::cout << "constr && \n";
-        other.memory = nullptr;
-        other.count = 0;
+    // Сколько объектов T еще можно выделить
+    std::size_t available() {
+        return pool().available();
     }
 
-    FixedAllocator& operator=(FixedAllocator&& other) noexcept {
-        if (this != &other) {
-            if (memory) {
-                std::free(memory);
-            }
-            memory = other.memory;
-            count = other.count;
-            other.memory = nullptr;
-            other.count = 0;
-        }
-        return *this;
-    }
-    
-private:
-    T* memory;
-    size_t count;
+    const std::shared_ptr<FixedArena>& resource() const noexcept { return arena; }
 };
 
 
-template <typename T, size_t Capacity>
-bool operator==(const FixedAllocator<T, Capacity> &, const FixedAllocator<T, Capacity> &) {
-  return true;
+template <typename T, typename U, size_t Capacity>
+bool operator==(const FixedAllocator<T, Capacity> &lhs, const FixedAllocator<U, Capacity> &rhs) {
+  return lhs.resource() == rhs.resource();
 }
 
-template <typename T, size_t Capacity>
-bool operator!=(const FixedAllocator<T, Capacity> &, const FixedAllocator<T, Capacity> &) {
-  return false;
-}
\ No newline at end of file
+template <typename T, typename U, size_t Capacity>
+bool operator!=(const FixedAllocator<T, Capacity> &lhs, const FixedAllocator<U, Capacity> &rhs) {
+  return lhs.resource() != rhs.resource();
+}
@@ -63,6 +63,9 @@ public:
         using other = PoolAllocator<U>;
     };
 
+    // Сколько чанков выделено
+    std::size_t chunkCount() const { return chunks.size(); }
+
 private:
     // Выделить новый чанк памяти и добавить блоки в список свободных
     void allocateChunk() {
@@ -0,0 +1,187 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Арена с классами размеров по степеням двойки: 16, 32, ... 4096 байт.
+// Запрос округляется вверх до класса, у каждого класса свой список свободных
+// блоков и свой текущий слэб, из которого блоки нарезаются по мере надобности.
+// Запросы больше MaxSmallSize и с выравниванием больше max_align_t идут
+// напрямую в operator new. Не потокобезопасна, как и PoolAllocator.
+class SlabArena {
+public:
+    static constexpr std::size_t MinClassShift = 4;     // 16 байт
+    static constexpr std::size_t MaxClassShift = 12;    // 4096 байт
+    static constexpr std::size_t ClassCount = MaxClassShift - MinClassShift + 1;
+    static constexpr std::size_t MaxSmallSize = std::size_t{1} << MaxClassShift;
+    static constexpr std::size_t DefaultSlabSize = 64 * 1024;
+
+    explicit SlabArena(std::size_t slabSize = DefaultSlabSize)
+        : slabSize(slabSize < MaxSmallSize ? MaxSmallSize : slabSize) {}
+
+    ~SlabArena() {
+        for (void* slab : slabs) {
+            ::operator delete(slab);
+        }
+    }
+
+    SlabArena(const SlabArena&) = delete;
+    SlabArena& operator=(const SlabArena&) = delete;
+
+    // номер класса для запроса в bytes байт (bytes <= MaxSmallSize)
+    static std::size_t sizeClass(std::size_t bytes) {
+        if (bytes <= (std::size_t{1} << MinClassShift)) {
+            return 0;
+        }
+        const std::size_t shift = 64 - static_cast<std::size_t>(__builtin_clzll(bytes - 1));
+        return shift - MinClassShift;
+    }
+
+    static std::size_t classSize(std::size_t index) {
+        return std::size_t{1} << (index + MinClassShift);
+    }
+
+    static bool isSmall(std::size_t bytes, std::size_t alignment) {
+        return bytes <= MaxSmallSize && alignment <= alignof(std::max_align_t);
+    }
+
+    void* allocate(std::size_t bytes, std::size_t alignment = alignof(std::max_align_t)) {
+        if (!isSmall(bytes, alignment)) {
+            return allocateLarge(bytes, alignment);
+        }
+        SizeClass& sc = classes[sizeClass(bytes)];
+        if (sc.freeList) {
+            Block* block = sc.freeList;
+            sc.freeList = block->next;
+            return block;
+        }
+        const std::size_t size = classSize(sizeClass(bytes));
+        if (sc.cursor == sc.end) {
+            char* slab = static_cast<char*>(::operator new(slabSize));
+            slabs.push_back(slab);
+            sc.cursor = slab;
+            // слэб делится на целое число блоков класса
+            sc.end = slab + slabSize / size * size;
+        }
+        void* result = sc.cursor;
+        sc.cursor += size;
+        return result;
+    }
+
+    void deallocate(void* p, std::size_t bytes, std::size_t alignment = alignof(std::max_align_t)) noexcept {
+        if (!isSmall(bytes, alignment)) {
+            deallocateLarge(p, alignment);
+            return;
+        }
+        SizeClass& sc = classes[sizeClass(bytes)];
+        Block* block = static_cast<Block*>(p);
+        block->next = sc.freeList;
+        sc.freeList = block;
+    }
+
+    // Сколько слэбов выделено
+    std::size_t slabCount() const { return slabs.size(); }
+
+private:
+    struct Block {
+        Block* next;
+    };
+
+    struct SizeClass {
+        Block* freeList = nullptr;   // освобожденные блоки
+        char* cursor = nullptr;      // еще не выданная часть текущего слэба
+        char* end = nullptr;
+    };
+
+    static void* allocateLarge(std::size_t bytes, std::size_t alignment) {
+        if (alignment > alignof(std::max_align_t)) {
+            return ::operator new(bytes, std::align_val_t(alignment));
+        }
+        return ::operator new(bytes);
+    }
+
+    static void deallocateLarge(void* p, std::size_t alignment) noexcept {
+        if (alignment > alignof(std::max_align_t)) {
+            ::operator delete(p, std::align_val_t(alignment));
+        } else {
+            ::operator delete(p);
+        }
+    }
+
+    std::size_t slabSize;
+    SizeClass classes[ClassCount];
+    std::vector<void*> slabs;
+};
+
+// Аллокатор поверх SlabArena для любых n: подходит для vector, deque,
+// unordered_map, строк. Копии и rebind-копии делят одну арену и равны между
+// собой, поэтому память, выделенная через аллокатор одного типа, освобождается
+// через аллокатор другого. Арена живет, пока жив хотя бы один аллокатор.
+template <typename T>
+class SlabAllocator {
+    template <typename U>
+    friend class SlabAllocator;
+
+    std::shared_ptr<SlabArena> arena;
+
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    SlabAllocator() : arena(std::make_shared<SlabArena>()) {}
+
+    explicit SlabAllocator(std::shared_ptr<SlabArena> arena) noexcept : arena(std::move(arena)) {}
+
+    // Перемещение тоже копирует: аллокатор-источник должен остаться рабочим
+    SlabAllocator(const SlabAllocator&) noexcept = default;
+    SlabAllocator& operator=(const SlabAllocator&) noexcept = default;
+
+    template <typename U>
+    SlabAllocator(const SlabAllocator<U>& other) noexcept : arena(other.arena) {}
+
+    T* allocate(std::size_t n) {
+        if (n > max_size()) {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept {
+        arena->deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    std::size_t max_size() const noexcept {
+        return static_cast<std::size_t>(-1) / sizeof(T);
+    }
+
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+        new (p) U(std::forward<Args>(args)...);
+    }
+
+    template <typename U>
+    void destroy(U* p) {
+        p->~U();
+    }
+
+    template <typename U>
+    struct rebind {
+        using other = SlabAllocator<U>;
+    };
+
+    const std::shared_ptr<SlabArena>& resource() const noexcept { return arena; }
+
+    // Сколько слэбов выделено в арене
+    std::size_t chunkCount() const { return arena->slabCount(); }
+};
+
+template <typename T, typename U>
+bool operator==(const SlabAllocator<T>& lhs, const SlabAllocator<U>& rhs) { return lhs.resource() == rhs.resource(); }
+
+template <typename T, typename U>
+bool operator!=(const SlabAllocator<T>& lhs, const SlabAllocator<U>& rhs) { return lhs.resource() != rhs.resource(); }
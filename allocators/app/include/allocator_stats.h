@@ -0,0 +1,235 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <cxxabi.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <typeindex>
+#include <typeinfo>
+#include <utility>
+
+// Счетчики одного аллокатора (одной специализации после rebind).
+// Атомарные, чтобы работать и с ConcurrentPoolAllocator.
+struct AllocationStats {
+    // корзина k - запросы размером от 2^(k-1)+1 до 2^k байт, последняя - все, что больше
+    static constexpr std::size_t HistogramBuckets = 24;
+
+    std::string name;
+    std::atomic<std::size_t> allocations{0};
+    std::atomic<std::size_t> deallocations{0};
+    std::atomic<std::size_t> bytesAllocated{0};
+    std::atomic<std::size_t> liveBytes{0};
+    std::atomic<std::size_t> peakBytes{0};      // максимум liveBytes
+    std::atomic<std::size_t> chunkGrowths{0};   // сколько раз аллокатор брал новый чанк
+    std::array<std::atomic<std::size_t>, HistogramBuckets> histogram;
+
+    explicit AllocationStats(std::string name) : name(std::move(name)) {
+        reset();
+    }
+
+    static std::size_t bucket(std::size_t bytes) {
+        if (bytes <= 1) {
+            return 0;
+        }
+        const std::size_t k = 64 - static_cast<std::size_t>(__builtin_clzll(bytes - 1));
+        return k < HistogramBuckets ? k : HistogramBuckets - 1;
+    }
+
+    void recordAllocate(std::size_t bytes) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        bytesAllocated.fetch_add(bytes, std::memory_order_relaxed);
+        histogram[bucket(bytes)].fetch_add(1, std::memory_order_relaxed);
+        const std::size_t live = liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        std::size_t peak = peakBytes.load(std::memory_order_relaxed);
+        while (live > peak && !peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+        }
+    }
+
+    void recordDeallocate(std::size_t bytes) {
+        deallocations.fetch_add(1, std::memory_order_relaxed);
+        liveBytes.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    void reset() {
+        for (auto* counter : {&allocations, &deallocations, &bytesAllocated, &liveBytes, &peakBytes, &chunkGrowths}) {
+            counter->store(0, std::memory_order_relaxed);
+        }
+        for (auto& counter : histogram) {
+            counter.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // строка отчета: счетчики и непустые корзины гистограммы
+    void report(std::ostream& out) const {
+        out << name << "\n"
+            << "  allocations: " << allocations.load() << ", deallocations: " << deallocations.load()
+            << ", bytes: " << bytesAllocated.load() << ", live: " << liveBytes.load()
+            << ", peak: " << peakBytes.load() << ", chunk growths: " << chunkGrowths.load() << "\n"
+            << "  sizes:";
+        for (std::size_t k = 0; k < HistogramBuckets; ++k) {
+            const std::size_t count = histogram[k].load();
+            if (count) {
+                out << (k + 1 < HistogramBuckets ? " <=" : " >") << (std::size_t{1} << (k + 1 < HistogramBuckets ? k : k - 1))
+                    << ":" << count;
+            }
+        }
+        out << "\n";
+    }
+};
+
+// Счетчики всех трассируемых аллокаторов по типу аллокатора
+class StatsRegistry {
+public:
+    static StatsRegistry& instance() {
+        static StatsRegistry registry;
+        return registry;
+    }
+
+    AllocationStats& forType(const std::type_info& type) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& stats = byType[std::type_index(type)];
+        if (!stats) {
+            stats = std::make_unique<AllocationStats>(demangle(type.name()));
+        }
+        return *stats;
+    }
+
+    void report(std::ostream& out) {
+        forEach([&](const AllocationStats& stats) { stats.report(out); });
+    }
+
+    // обход счетчиков всех аллокаторов, в том числе rebind-специализаций,
+    // тип которых снаружи не назвать (узлы контейнеров)
+    template <typename F>
+    void forEach(F f) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& entry : byType) {
+            f(*entry.second);
+        }
+    }
+
+    void resetAll() {
+        forEach([](AllocationStats& stats) { stats.reset(); });
+    }
+
+private:
+    static std::string demangle(const char* name) {
+        int status = 0;
+        std::unique_ptr<char, void (*)(void*)> demangled(abi::__cxa_demangle(name, nullptr, nullptr, &status), std::free);
+        return status == 0 ? demangled.get() : name;
+    }
+
+    std::mutex mutex;
+    std::map<std::type_index, std::unique_ptr<AllocationStats>> byType;
+};
+
+namespace detail {
+
+template <typename Alloc, typename = void>
+struct HasChunkCount : std::false_type {};
+
+template <typename Alloc>
+struct HasChunkCount<Alloc, std::void_t<decltype(std::declval<const Alloc&>().chunkCount())>> : std::true_type {};
+
+} // namespace detail
+
+// Обертка над любым аллокатором: считает выделения, байты, пик живой памяти,
+// размеры запросов и рост чанков (если аллокатор сообщает chunkCount()).
+// rebind оборачивает rebind внутреннего аллокатора, так что узлы контейнера
+// тоже считаются, отдельно от value_type.
+template <typename Inner>
+class TracingAllocator {
+    template <typename U>
+    friend class TracingAllocator;
+
+    using Traits = std::allocator_traits<Inner>;
+
+    Inner inner;
+
+    static AllocationStats& counters() {
+        static AllocationStats& stats = StatsRegistry::instance().forType(typeid(Inner));
+        return stats;
+    }
+
+    std::size_t chunks() const {
+        if constexpr (detail::HasChunkCount<Inner>::value) {
+            return inner.chunkCount();
+        } else {
+            return 0;
+        }
+    }
+
+public:
+    using value_type = typename Traits::value_type;
+    using propagate_on_container_copy_assignment = typename Traits::propagate_on_container_copy_assignment;
+    using propagate_on_container_move_assignment = typename Traits::propagate_on_container_move_assignment;
+    using propagate_on_container_swap = typename Traits::propagate_on_container_swap;
+
+    TracingAllocator() = default;
+
+    explicit TracingAllocator(Inner inner) : inner(std::move(inner)) {}
+
+    template <typename U>
+    TracingAllocator(const TracingAllocator<U>& other) : inner(other.inner) {}
+
+    template <typename U>
+    struct rebind {
+        using other = TracingAllocator<typename Traits::template rebind_alloc<U>>;
+    };
+
+    value_type* allocate(std::size_t n) {
+        const std::size_t before = chunks();
+        value_type* p = Traits::allocate(inner, n);
+        counters().recordAllocate(n * sizeof(value_type));
+        if (chunks() != before) {
+            counters().chunkGrowths.fetch_add(1, std::memory_order_relaxed);
+        }
+        return p;
+    }
+
+    void deallocate(value_type* p, std::size_t n) {
+        counters().recordDeallocate(n * sizeof(value_type));
+        Traits::deallocate(inner, p, n);
+    }
+
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+        Traits::construct(inner, p, std::forward<Args>(args)...);
+    }
+
+    template <typename U>
+    void destroy(U* p) {
+        Traits::destroy(inner, p);
+    }
+
+    TracingAllocator select_on_container_copy_construction() const {
+        return TracingAllocator(Traits::select_on_container_copy_construction(inner));
+    }
+
+    // счетчики этой специализации
+    static AllocationStats& stats() { return counters(); }
+
+    const Inner& base() const { return inner; }
+};
+
+template <typename A, typename B>
+bool operator==(const TracingAllocator<A>& lhs, const TracingAllocator<B>& rhs) { return lhs.base() == rhs.base(); }
+
+template <typename A, typename B>
+bool operator!=(const TracingAllocator<A>& lhs, const TracingAllocator<B>& rhs) { return !(lhs == rhs); }
+
+// Трассировка включается при сборке с ALLOCATOR_STATS (cmake -DALLOCATOR_STATS=ON),
+// без нее MaybeTraced<A> - это сам A, и накладных расходов нет вовсе
+#ifdef ALLOCATOR_STATS
+template <typename Alloc>
+using MaybeTraced = TracingAllocator<Alloc>;
+#else
+template <typename Alloc>
+using MaybeTraced = Alloc;
+#endif
@@ -0,0 +1,132 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include "allocator_fix.h"
+#include "allocator_slab.h"
+
+// Стратегии выделения как std::pmr::memory_resource: контейнеры std::pmr
+// одного типа могут брать память из любой из них, стратегия выбирается
+// во время выполнения, а не параметром шаблона. Ни один ресурс не потокобезопасен.
+
+// Пул с классами размеров поверх SlabArena
+class PoolResource : public std::pmr::memory_resource {
+public:
+    explicit PoolResource(std::size_t slabSize = SlabArena::DefaultSlabSize) : arena(slabSize) {}
+
+    const SlabArena& pool() const { return arena; }
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        return arena.allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+        arena.deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    SlabArena arena;
+};
+
+// Монотонный буфер, как StackAllocator: память выдается подряд из внешнего
+// буфера, освобождение ничего не делает, при переполнении - bad_alloc.
+// release() начинает буфер сначала.
+class StackResource : public std::pmr::memory_resource {
+public:
+    StackResource(char* buffer, std::size_t size) : buffer(buffer), size(size) {}
+
+    void release() { used = 0; }
+
+    std::size_t bytesUsed() const { return used; }
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        // выравниваем адрес, а не смещение: буфер может быть выровнен слабее запроса
+        const auto base = reinterpret_cast<std::uintptr_t>(buffer);
+        const std::uintptr_t start = (base + used + alignment - 1) & ~(static_cast<std::uintptr_t>(alignment) - 1);
+        const std::size_t offset = start - base;
+        if (offset > size || bytes > size - offset) {
+            throw std::bad_alloc();  // Недостаточно памяти
+        }
+        used = offset + bytes;
+        return buffer + offset;
+    }
+
+    void do_deallocate(void*, std::size_t, std::size_t) override {
+        // Никаких действий не требуется
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    char* buffer;
+    std::size_t size;
+    std::size_t used = 0;
+};
+
+// StackResource со своим буфером: объект на стеке - буфер на стеке
+template <std::size_t BufferSize>
+class InlineStackResource : public StackResource {
+public:
+    InlineStackResource() : StackResource(storage, BufferSize) {}
+
+    InlineStackResource(const InlineStackResource&) = delete;
+    InlineStackResource& operator=(const InlineStackResource&) = delete;
+
+private:
+    alignas(std::max_align_t) char storage[BufferSize];
+};
+
+// Фиксированная вместимость, как FixedAllocator: capacity ячеек одного размера,
+// освобожденные ячейки выдаются снова. Только для узловых контейнеров (map,
+// set, list): размер ячейки задает первое выделение, запрос другого размера
+// или выравнивания - bad_alloc. Растущий vector или строка иначе заводили бы
+// по пулу на capacity ячеек для каждого нового размера.
+class FixedResource : public std::pmr::memory_resource {
+public:
+    explicit FixedResource(std::size_t capacity) : arena(capacity) {}
+
+private:
+    // ячейка вмещает запрос и ссылку списка свободных
+    static std::size_t slotAlign(std::size_t alignment) {
+        return alignment > alignof(void*) ? alignment : alignof(void*);
+    }
+
+    static std::size_t slotSize(std::size_t bytes, std::size_t alignment) {
+        const std::size_t align = slotAlign(alignment);
+        return ((bytes > sizeof(void*) ? bytes : sizeof(void*)) + align - 1) / align * align;
+    }
+
+    FixedSlotPool& pool(std::size_t bytes, std::size_t alignment) {
+        const std::size_t size = slotSize(bytes, alignment);
+        const std::size_t align = slotAlign(alignment);
+        if (!slots) {
+            slots = &arena.pool(size, align);
+        } else if (!slots->fits(size, align)) {
+            throw std::bad_alloc();  // ячейки другого размера не заводим
+        }
+        return *slots;
+    }
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        return pool(bytes, alignment).allocate(1);
+    }
+
+    void do_deallocate(void* p, std::size_t, std::size_t) override {
+        // освобождается только то, что выдано единственным пулом
+        slots->deallocate(p, 1);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    FixedArena arena;
+    FixedSlotPool* slots = nullptr;   // единственный пул, заводится первым выделением
+};
@@ -1,10 +1,21 @@
 #include "allocator_stack.h"
 #include "allocator_fix.h"
 #include "allocator_pool.h"
+#include "allocator_concurrent_pool.h"
+#include "allocator_slab.h"
+#include "memory_resources.h"
+#include "allocator_stats.h"
 #include "CustomContainer.h"
 #include <iostream>
 #include <memory>
 #include <map>
+#include <list>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <atomic>
 #include <stdexcept>
 #include <chrono>
 #include <random>
@@ -39,7 +50,7 @@ void testPerformance()
     // Кастомный аллокатор
     benchmark("Custom Pool Allocator", [&]()
               {
-        using CustomAllocator = PoolAllocator<std::pair<const int, std::string>>;
+        using CustomAllocator = MaybeTraced<PoolAllocator<std::pair<const int, std::string>>>;
         std::map<int, std::string, std::less<>, CustomAllocator> myMap;
         for (int i = 0; i < numElements; ++i) {
             myMap.emplace(i, "Value");
@@ -76,8 +87,9 @@ void testReadPerformance()
     // Кастомный аллокатор (StackAllocator)
     benchmark("Stack Allocator - Reads", [&]()
               {
-        using CustomAllocator = StackAllocator<std::pair<const int, std::string>, BufferSize / sizeof(std::pair<const int, std::string>)>;
-        std::map<int, std::string, std::less<>, CustomAllocator> myMap{CustomAllocator(buffer)};
+        using StackAlloc = StackAllocator<std::pair<const int, std::string>, BufferSize / sizeof(std::pair<const int, std::string>)>;
+        using CustomAllocator = MaybeTraced<StackAlloc>;
+        std::map<int, std::string, std::less<>, CustomAllocator> myMap{CustomAllocator(StackAlloc(buffer))};
         for (int i = 0; i < numElements/100; ++i) {
             myMap.emplace(i, "Value");
         }
@@ -88,6 +100,265 @@ void testReadPerformance()
         } });
 }
 
+// Существующий PoolAllocator можно разделить между потоками только под мьютексом
+template <typename T>
+struct LockedPoolAllocator
+{
+    using value_type = T;
+
+    LockedPoolAllocator() = default;
+    template <typename U>
+    LockedPoolAllocator(const LockedPoolAllocator<U> &) {}
+
+    static PoolAllocator<T> &pool()
+    {
+        static PoolAllocator<T> instance;
+        return instance;
+    }
+
+    static std::mutex &mutex()
+    {
+        static std::mutex instance;
+        return instance;
+    }
+
+    T *allocate(std::size_t n)
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        return pool().allocate(n);
+    }
+
+    void deallocate(T *p, std::size_t n)
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        pool().deallocate(p, n);
+    }
+
+    template <typename U>
+    struct rebind
+    {
+        using other = LockedPoolAllocator<U>;
+    };
+};
+
+template <typename T, typename U>
+bool operator==(const LockedPoolAllocator<T> &, const LockedPoolAllocator<U> &) { return true; }
+
+template <typename T, typename U>
+bool operator!=(const LockedPoolAllocator<T> &, const LockedPoolAllocator<U> &) { return false; }
+
+// Барьер для потоков бенчмарка
+class SpinBarrier
+{
+    std::atomic<unsigned> waiting{0};
+    std::atomic<unsigned> generation{0};
+    unsigned count;
+
+public:
+    explicit SpinBarrier(unsigned count) : count(count) {}
+
+    void wait()
+    {
+        const unsigned gen = generation.load(std::memory_order_acquire);
+        if (waiting.fetch_add(1, std::memory_order_acq_rel) + 1 == count)
+        {
+            waiting.store(0, std::memory_order_relaxed);
+            generation.fetch_add(1, std::memory_order_release);
+            return;
+        }
+        while (generation.load(std::memory_order_acquire) == gen)
+        {
+            std::this_thread::yield();
+        }
+    }
+};
+
+template <typename Func>
+void runThreads(unsigned threads, Func func)
+{
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t)
+    {
+        workers.emplace_back(func, t);
+    }
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+// Каждый поток сам заполняет и очищает свой список
+template <typename Alloc>
+void localChurn(unsigned threads, int rounds, int elements)
+{
+    runThreads(threads, [&](unsigned)
+               {
+        for (int r = 0; r < rounds; ++r) {
+            std::list<int, Alloc> list;
+            for (int i = 0; i < elements; ++i) {
+                list.push_back(i);
+            }
+        } });
+}
+
+// Поток освобождает объекты, выделенные соседним потоком
+template <typename Alloc>
+void remoteFree(unsigned threads, int rounds, int elements)
+{
+    using T = typename Alloc::value_type;
+    // два комплекта указателей на поток: пока сосед освобождает один, поток заполняет другой
+    std::vector<std::vector<T *>> slots(threads * 2, std::vector<T *>(elements));
+    SpinBarrier barrier(threads);
+    runThreads(threads, [&](unsigned t)
+               {
+        Alloc alloc;
+        for (int r = 0; r < rounds; ++r) {
+            auto &own = slots[t * 2 + r % 2];
+            for (auto &p : own) {
+                p = alloc.allocate(1);
+            }
+            barrier.wait();
+            for (auto p : slots[(t + 1) % threads * 2 + r % 2]) {
+                alloc.deallocate(p, 1);
+            }
+        } });
+}
+
+// Тест производительности из нескольких потоков
+void testConcurrentPerformance()
+{
+    const unsigned threads = 4;
+    const int rounds = 200;
+    const int elements = 1000;
+    struct Payload
+    {
+        char data[32];
+    };
+
+    benchmark("Standard Allocator - Threads", [&]()
+              { localChurn<std::allocator<int>>(threads, rounds, elements); });
+    benchmark("Locked Pool Allocator - Threads", [&]()
+              { localChurn<LockedPoolAllocator<int>>(threads, rounds, elements); });
+    benchmark("Concurrent Pool Allocator - Threads", [&]()
+              { localChurn<ConcurrentPoolAllocator<int>>(threads, rounds, elements); });
+
+    benchmark("Standard Allocator - Remote free", [&]()
+              { remoteFree<std::allocator<Payload>>(threads, rounds, elements); });
+    benchmark("Locked Pool Allocator - Remote free", [&]()
+              { remoteFree<LockedPoolAllocator<Payload>>(threads, rounds, elements); });
+    benchmark("Concurrent Pool Allocator - Remote free", [&]()
+              { remoteFree<ConcurrentPoolAllocator<Payload>>(threads, rounds, elements); });
+}
+
+// Тест производительности контейнеров с выделением по n объектов
+void testSlabPerformance()
+{
+    const int numElements = 1'000'000;
+    const int rounds = 1000;
+
+    benchmark("Standard Allocator - unordered_map", [&]()
+              {
+        std::unordered_map<int, int> map;
+        for (int i = 0; i < numElements; ++i) {
+            map.emplace(i, i);
+        } });
+
+    benchmark("Slab Allocator - unordered_map", [&]()
+              {
+        using Alloc = SlabAllocator<std::pair<const int, int>>;
+        std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, Alloc> map;
+        for (int i = 0; i < numElements; ++i) {
+            map.emplace(i, i);
+        } });
+
+    // короткоживущие векторы и строки: блоки повторно берутся из списков классов
+    benchmark("Standard Allocator - vectors and strings", [&]()
+              {
+        for (int r = 0; r < rounds; ++r) {
+            std::vector<std::string> values;
+            for (int i = 0; i < 100; ++i) {
+                std::string value("a string that does not fit SSO ");
+                value += std::to_string(i).c_str();
+                values.push_back(std::move(value));
+            }
+        } });
+
+    benchmark("Slab Allocator - vectors and strings", [&]()
+              {
+        using String = std::basic_string<char, std::char_traits<char>, SlabAllocator<char>>;
+        SlabAllocator<String> alloc;
+        for (int r = 0; r < rounds; ++r) {
+            std::vector<String, SlabAllocator<String>> values(alloc);
+            for (int i = 0; i < 100; ++i) {
+                String value("a string that does not fit SSO ", alloc);
+                value += std::to_string(i).c_str();
+                values.push_back(std::move(value));
+            }
+        } });
+}
+
+// Один и тот же std::pmr::map на разных memory_resource
+void fillPmrMap(std::pmr::memory_resource *resource, int rounds, int elements)
+{
+    for (int r = 0; r < rounds; ++r)
+    {
+        std::pmr::map<int, int> map(resource);
+        for (int i = 0; i < elements; ++i)
+        {
+            map.emplace(i, i);
+        }
+    }
+}
+
+// Тест производительности memory_resource против аллокаторов-параметров шаблона
+void testMemoryResourcePerformance()
+{
+    const int rounds = 10'000;
+    const int elements = 100;
+    using Value = std::pair<const int, int>;
+
+    benchmark("Standard Allocator - small maps", [&]()
+              {
+        for (int r = 0; r < rounds; ++r) {
+            std::map<int, int> map;
+            for (int i = 0; i < elements; ++i) {
+                map.emplace(i, i);
+            }
+        } });
+    benchmark("Pool Allocator - small maps", [&]()
+              {
+        for (int r = 0; r < rounds; ++r) {
+            std::map<int, int, std::less<>, PoolAllocator<Value>> map;
+            for (int i = 0; i < elements; ++i) {
+                map.emplace(i, i);
+            }
+        } });
+
+    benchmark("new_delete_resource - small maps", [&]()
+              { fillPmrMap(std::pmr::new_delete_resource(), rounds, elements); });
+
+    PoolResource pool;
+    benchmark("PoolResource - small maps", [&]()
+              { fillPmrMap(&pool, rounds, elements); });
+
+    FixedResource fixed(elements);
+    benchmark("FixedResource - small maps", [&]()
+              { fillPmrMap(&fixed, rounds, elements); });
+
+    // буфер на стеке начинается заново на каждом круге
+    benchmark("StackResource - small maps", [&]()
+              {
+        InlineStackResource<elements * 64> stack;
+        for (int r = 0; r < rounds; ++r) {
+            stack.release();
+            fillPmrMap(&stack, 1, elements);
+        } });
+
+    std::pmr::unsynchronized_pool_resource stdPool;
+    benchmark("unsynchronized_pool_resource - small maps", [&]()
+              { fillPmrMap(&stdPool, rounds, elements); });
+}
+
 int factorial(int n)
 {
     int result = 1;
@@ -230,5 +501,12 @@ int main()
 
     testPerformance();
     testReadPerformance();
+    testConcurrentPerformance();
+    testSlabPerformance();
+    testMemoryResourcePerformance();
+#ifdef ALLOCATOR_STATS
+    std::cout << "allocator statistics \n";
+    StatsRegistry::instance().report(std::cout);
+#endif
     return 0;
 }
\ No newline at end of file
@@ -3,9 +3,22 @@
 #include "allocator_stack.h"
 #include "allocator_fix.h"
 #include "allocator_pool.h"
+#include "allocator_concurrent_pool.h"
+#include "allocator_slab.h"
+#include "memory_resources.h"
+#include "allocator_stats.h"
 #include "CustomContainer.h"
 #include <vector>
 #include <map>
+#include <set>
+#include <list>
+#include <thread>
+#include <mutex>
+#include <array>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <sstream>
 
 class StackAllocatorTest : public ::testing::Test {
 protected:
@@ -118,6 +131,485 @@ TEST(MapWithPoolAllocatorTest, AddAndRemoveElements) {
 
 }
 
+// Тесты для ConcurrentPoolAllocator
+TEST(ConcurrentPoolAllocatorTest, MapAddAndRemoveElements) {
+    using Alloc = ConcurrentPoolAllocator<std::pair<const int, int>>;
+    std::map<int, int, std::less<>, Alloc> myMap;
+    const int numElements = 10000;
+    for (int i = 0; i < numElements; ++i) {
+        myMap[i] = i * 2;
+    }
+    for (int i = 0; i < numElements; i += 2) {
+        myMap.erase(i);
+    }
+    EXPECT_EQ(myMap.size(), numElements / 2);
+    for (int i = 1; i < numElements; i += 2) {
+        EXPECT_EQ(myMap[i], i * 2);
+    }
+}
+
+TEST(ConcurrentPoolAllocatorTest, ReusesFreedBlock) {
+    ConcurrentPoolAllocator<long> alloc;
+    long* p = alloc.allocate(1);
+    alloc.deallocate(p, 1);
+    EXPECT_EQ(alloc.allocate(1), p);  // блок из локального списка потока
+    ASSERT_THROW(alloc.allocate(2), std::bad_alloc);
+    alloc.deallocate(p, 1);
+}
+
+TEST(ConcurrentPoolAllocatorTest, ThreadsGetDistinctBlocks) {
+    struct Item { long a, b, c, d; };
+    const int numThreads = 4;
+    const int perThread = 5000;
+    std::vector<std::vector<Item*>> allocated(numThreads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&, t] {
+            ConcurrentPoolAllocator<Item> alloc;
+            for (int i = 0; i < perThread; ++i) {
+                Item* p = alloc.allocate(1);
+                p->a = t;
+                p->d = i;
+                allocated[t].push_back(p);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::set<Item*> unique;
+    for (int t = 0; t < numThreads; ++t) {
+        for (int i = 0; i < perThread; ++i) {
+            Item* p = allocated[t][i];
+            EXPECT_EQ(p->a, t);  // блок не выдан второму потоку
+            EXPECT_EQ(p->d, i);
+            unique.insert(p);
+        }
+    }
+    EXPECT_EQ(unique.size(), static_cast<std::size_t>(numThreads * perThread));
+
+    // освобождение в другом потоке, не в том, где выделяли
+    ConcurrentPoolAllocator<Item> alloc;
+    for (auto& items : allocated) {
+        for (Item* p : items) {
+            alloc.deallocate(p, 1);
+        }
+    }
+}
+
+TEST(ConcurrentPoolAllocatorTest, RemoteFreesAreReused) {
+    using Alloc = ConcurrentPoolAllocator<std::array<char, 200>>;
+    const std::size_t chunkBlocks = Alloc::Pool::BatchSize * Alloc::Pool::BatchesPerChunk;
+    Alloc alloc;
+    // поток-производитель выделяет, этот поток освобождает - много раз подряд
+    for (int round = 0; round < 20; ++round) {
+        std::vector<Alloc::value_type*> blocks;
+        std::thread producer([&] {
+            for (std::size_t i = 0; i < chunkBlocks; ++i) {
+                blocks.push_back(alloc.allocate(1));
+            }
+        });
+        producer.join();
+        for (auto p : blocks) {
+            alloc.deallocate(p, 1);
+        }
+    }
+    // освобожденные пачки возвращаются на склад, чанки не плодятся на каждом круге
+    EXPECT_LE(Alloc::Pool::instance().chunkCount(), 3u);
+}
+
+TEST(ConcurrentPoolAllocatorTest, SharedListUnderMutex) {
+    std::list<int, ConcurrentPoolAllocator<int>> shared;
+    std::mutex mutex;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < 2000; ++i) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (i % 3 == 2) {
+                    shared.pop_front();  // узел, созданный, возможно, другим потоком
+                } else {
+                    shared.push_back(t * 10000 + i);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(shared.size(), 4u * (2000 - 2 * (2000 / 3)));
+}
+
+// свой размер блока, чтобы склад этого пула видел только этот тест
+using LateFreeAlloc = ConcurrentPoolAllocator<std::array<char, 1000>>;
+
+// thread_local, созданный раньше кэша пула, разрушается после него
+struct LateFree {
+    LateFreeAlloc::value_type* block = nullptr;
+    ~LateFree() { LateFreeAlloc().deallocate(block, 1); }
+};
+
+TEST(ConcurrentPoolAllocatorTest, FreeAfterThreadCacheDestroyed) {
+    LateFreeAlloc::value_type* block = nullptr;
+    std::thread([&] {
+        static thread_local LateFree late;
+        late.block = block = LateFreeAlloc().allocate(1);
+    }).join();
+    // блок, освобожденный после разрушения кэша, ушел на склад, а не в мертвый кэш
+    LateFreeAlloc alloc;
+    EXPECT_EQ(alloc.allocate(1), block);
+    alloc.deallocate(block, 1);
+    EXPECT_EQ(LateFreeAlloc::Pool::instance().chunkCount(), 1u);
+}
+
+// Тесты для SlabAllocator
+TEST(SlabAllocatorTest, SizeClasses) {
+    EXPECT_EQ(SlabArena::sizeClass(1), 0u);
+    EXPECT_EQ(SlabArena::sizeClass(16), 0u);
+    EXPECT_EQ(SlabArena::sizeClass(17), 1u);
+    EXPECT_EQ(SlabArena::sizeClass(64), 2u);
+    EXPECT_EQ(SlabArena::sizeClass(4096), SlabArena::ClassCount - 1);
+    EXPECT_EQ(SlabArena::classSize(SlabArena::sizeClass(100)), 128u);
+}
+
+TEST(SlabAllocatorTest, ReusesBlockOfSameClass) {
+    SlabAllocator<int> alloc;
+    int* p = alloc.allocate(20);         // 80 байт -> класс 128
+    alloc.deallocate(p, 20);
+    EXPECT_EQ(alloc.allocate(30), p);    // 120 байт -> тот же класс
+    alloc.deallocate(p, 30);
+
+    // большой объект мимо слэбов
+    const std::size_t slabs = alloc.resource()->slabCount();
+    int* big = alloc.allocate(10000);
+    big[9999] = 1;
+    alloc.deallocate(big, 10000);
+    EXPECT_EQ(alloc.resource()->slabCount(), slabs);
+}
+
+TEST(SlabAllocatorTest, OverAlignedType) {
+    struct alignas(64) Line { char data[64]; };
+    SlabAllocator<Line> alloc;
+    Line* p = alloc.allocate(3);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(p) % 64, 0u);
+    alloc.deallocate(p, 3);
+}
+
+TEST(SlabAllocatorTest, RebindSharesArena) {
+    SlabAllocator<int> ints;
+    SlabAllocator<double> doubles(ints);
+    SlabAllocator<int> back(doubles);
+    EXPECT_TRUE(ints == doubles);
+    EXPECT_TRUE(back == ints);
+    EXPECT_FALSE(ints == SlabAllocator<int>());
+
+    double* p = doubles.allocate(4);
+    std::allocator_traits<SlabAllocator<int>>::rebind_alloc<double>(back).deallocate(p, 4);
+}
+
+TEST(SlabAllocatorTest, Containers) {
+    SlabAllocator<int> alloc;
+
+    std::vector<int, SlabAllocator<int>> vec(alloc);
+    for (int i = 0; i < 100000; ++i) {
+        vec.push_back(i);
+    }
+    EXPECT_EQ(vec[99999], 99999);
+
+    std::deque<int, SlabAllocator<int>> deq(alloc);
+    for (int i = 0; i < 10000; ++i) {
+        deq.push_front(i);
+    }
+    EXPECT_EQ(deq.front(), 9999);
+
+    using String = std::basic_string<char, std::char_traits<char>, SlabAllocator<char>>;
+    String str("short", alloc);
+    for (int i = 0; i < 100; ++i) {
+        str += " and a longer tail";
+    }
+    EXPECT_EQ(str.size(), 5u + 100 * 18);
+
+    using Map = std::unordered_map<int, String, std::hash<int>, std::equal_to<int>,
+                                   SlabAllocator<std::pair<const int, String>>>;
+    Map map(0, std::hash<int>(), std::equal_to<int>(), alloc);
+    for (int i = 0; i < 10000; ++i) {
+        map.emplace(i, String("value " + std::to_string(i), alloc));
+    }
+    for (int i = 0; i < 10000; i += 2) {
+        map.erase(i);
+    }
+    EXPECT_EQ(map.size(), 5000u);
+    EXPECT_EQ(map.at(4321), String("value 4321", alloc));
+
+    // копия контейнера делит арену, перемещение забирает аллокатор с собой
+    auto copy = vec;
+    EXPECT_TRUE(copy.get_allocator() == alloc);
+    std::vector<int, SlabAllocator<int>> other;
+    other = std::move(copy);
+    EXPECT_TRUE(other.get_allocator() == alloc);
+    EXPECT_EQ(other.size(), vec.size());
+}
+
+// Тесты для FixedAllocator
+TEST(FixedAllocatorTest, ReusesFreedSlots) {
+    FixedAllocator<int, 4> alloc;
+    int* a = alloc.allocate(1);
+    int* b = alloc.allocate(3);
+    ASSERT_THROW(alloc.allocate(1), std::bad_alloc);
+    alloc.deallocate(a, 1);
+    EXPECT_EQ(alloc.allocate(1), a);
+    alloc.deallocate(b, 3);       // три ячейки возвращаются по одной
+    EXPECT_EQ(alloc.available(), 3u);
+    ASSERT_THROW(alloc.allocate(2), std::bad_alloc);  // подряд - только из хвоста
+}
+
+TEST(FixedAllocatorTest, MapChurnAtSteadyState) {
+    using Alloc = FixedAllocator<std::pair<const int, std::string>, 16>;
+    std::map<int, std::string, std::less<>, Alloc> myMap;
+    for (int i = 0; i < 100000; ++i) {
+        myMap.emplace(i, "value " + std::to_string(i));
+        if (myMap.size() > 10) {
+            myMap.erase(myMap.begin());
+        }
+    }
+    EXPECT_EQ(myMap.size(), 10u);
+    EXPECT_EQ(myMap.begin()->first, 99990);
+}
+
+TEST(FixedAllocatorTest, SlotAlignment) {
+    struct alignas(32) Wide { char data[40]; };
+    FixedAllocator<Wide, 8> alloc;
+    for (int i = 0; i < 8; ++i) {
+        Wide* p = alloc.allocate(1);
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(p) % 32, 0u);
+    }
+    FixedAllocator<char, 8> chars(alloc);   // свой пул под ячейки другого размера
+    EXPECT_NO_THROW(chars.allocate(8));
+}
+
+TEST(FixedAllocatorTest, ContainerCopyAndMove) {
+    using Alloc = FixedAllocator<std::pair<const int, int>, 10>;
+    std::map<int, int, std::less<>, Alloc> original;
+    for (int i = 0; i < 10; ++i) {
+        original[i] = i * i;
+    }
+
+    // копия получает свою арену на 10 узлов
+    auto copy = original;
+    EXPECT_FALSE(copy.get_allocator() == original.get_allocator());
+    EXPECT_EQ(copy, original);
+
+    // перемещение забирает арену вместе с узлами
+    auto moved = std::move(original);
+    EXPECT_EQ(moved.size(), 10u);
+    moved.erase(0);
+    moved[100] = 1;
+    EXPECT_EQ(moved.size(), 10u);
+
+    // копирующее присваивание - в узлы своей арены
+    std::map<int, int, std::less<>, Alloc> assigned;
+    assigned[-1] = 0;
+    assigned = copy;
+    EXPECT_EQ(assigned, copy);
+    EXPECT_FALSE(assigned.get_allocator() == copy.get_allocator());
+}
+
+// Тесты для memory_resource
+TEST(MemoryResourceTest, StackResourceIsMonotonic) {
+    alignas(std::max_align_t) char buffer[256];
+    StackResource resource(buffer, sizeof(buffer));
+    void* a = resource.allocate(10, 1);
+    void* b = resource.allocate(8, 8);
+    EXPECT_EQ(a, buffer);
+    EXPECT_EQ(b, buffer + 16);                        // выровнено до 8
+    resource.deallocate(b, 8, 8);
+    EXPECT_EQ(resource.bytesUsed(), 24u);             // освобождение ничего не возвращает
+    ASSERT_THROW((void)resource.allocate(300, 1), std::bad_alloc);
+    resource.release();
+    EXPECT_EQ(resource.allocate(1, 1), buffer);
+}
+
+TEST(MemoryResourceTest, InlineStackResourceBacksPmrVector) {
+    InlineStackResource<4096> resource;
+    std::pmr::vector<int> vec(&resource);
+    vec.reserve(100);
+    for (int i = 0; i < 100; ++i) {
+        vec.push_back(i);
+    }
+    EXPECT_EQ(vec[99], 99);
+    EXPECT_GE(resource.bytesUsed(), 100 * sizeof(int));
+}
+
+TEST(MemoryResourceTest, PoolResourceReusesBlocks) {
+    PoolResource resource;
+    void* p = resource.allocate(100, 8);
+    resource.deallocate(p, 100, 8);
+    EXPECT_EQ(resource.allocate(120, 8), p);          // тот же класс 128
+    EXPECT_FALSE(resource.is_equal(*std::pmr::new_delete_resource()));
+    EXPECT_TRUE(resource.is_equal(resource));
+}
+
+TEST(MemoryResourceTest, FixedResourceChurn) {
+    FixedResource resource(16);
+    std::pmr::map<int, int> myMap(&resource);
+    for (int i = 0; i < 10000; ++i) {
+        myMap.emplace(i, i * 2);
+        if (myMap.size() > 8) {
+            myMap.erase(myMap.begin());
+        }
+    }
+    EXPECT_EQ(myMap.size(), 8u);
+    EXPECT_EQ(myMap.rbegin()->second, 9999 * 2);
+}
+
+TEST(MemoryResourceTest, FixedResourceRejectsOtherSizes) {
+    FixedResource resource(1000);
+    void* node = resource.allocate(40, 8);
+    // растущий вектор просит ячейки других размеров - отказ, а не новый пул на каждый размер
+    std::pmr::vector<int> vec(&resource);
+    ASSERT_THROW(vec.resize(100), std::bad_alloc);
+    ASSERT_THROW((void)resource.allocate(40, 64), std::bad_alloc);
+    resource.deallocate(node, 40, 8);
+    EXPECT_EQ(resource.allocate(33, 8), node);   // та же ячейка 40 байт
+}
+
+// один тип контейнера, стратегия выбирается во время выполнения
+TEST(MemoryResourceTest, SameContainerTypeAnyStrategy) {
+    auto fill = [](std::pmr::memory_resource* resource) {
+        std::pmr::map<int, int> myMap(resource);
+        for (int i = 0; i < 8; ++i) {
+            myMap[i] = i * i;
+        }
+        return myMap.at(7);
+    };
+    PoolResource pool;
+    InlineStackResource<2048> stack;
+    FixedResource fixed(8);
+    for (std::pmr::memory_resource* resource :
+         {static_cast<std::pmr::memory_resource*>(&pool), static_cast<std::pmr::memory_resource*>(&stack),
+          static_cast<std::pmr::memory_resource*>(&fixed), std::pmr::new_delete_resource()}) {
+        EXPECT_EQ(fill(resource), 49);
+    }
+}
+
+// Тесты для TracingAllocator
+// Счетчики единственного аллокатора, который выделял память после resetAll.
+// Так находится аллокатор узлов контейнера, не называя тип узла стандартной библиотеки.
+AllocationStats* onlyActiveStats() {
+    AllocationStats* found = nullptr;
+    std::size_t active = 0;
+    StatsRegistry::instance().forEach([&](AllocationStats& stats) {
+        if (stats.allocations.load()) {
+            found = &stats;
+            ++active;
+        }
+    });
+    return active == 1 ? found : nullptr;
+}
+
+TEST(TracingAllocatorTest, CountsNodeAllocationsAndChunks) {
+    using Alloc = TracingAllocator<PoolAllocator<std::pair<const int, int>>>;
+    StatsRegistry::instance().resetAll();
+    AllocationStats* stats = nullptr;
+    {
+        std::map<int, int, std::less<>, Alloc> myMap;
+        for (int i = 0; i < 3000; ++i) {
+            myMap[i] = i;
+        }
+        for (int i = 0; i < 1000; ++i) {
+            myMap.erase(i);
+        }
+        // value_type не выделялся вовсе, все выделения - узлы
+        EXPECT_EQ(Alloc::stats().allocations.load(), 0u);
+        stats = onlyActiveStats();
+        ASSERT_NE(stats, nullptr);
+        EXPECT_NE(stats->name.find("PoolAllocator"), std::string::npos);
+        EXPECT_EQ(stats->allocations.load(), 3000u);
+        EXPECT_EQ(stats->deallocations.load(), 1000u);
+        // размер узла - деталь реализации библиотеки, проверяем только соотношение
+        const std::size_t nodeSize = stats->liveBytes.load() / 2000;
+        EXPECT_GE(nodeSize, sizeof(std::pair<const int, int>));
+        EXPECT_EQ(stats->liveBytes.load(), 2000 * nodeSize);
+        EXPECT_EQ(stats->peakBytes.load(), 3000 * nodeSize);
+        EXPECT_EQ(stats->chunkGrowths.load(), 3u);     // по 1024 блока в чанке
+    }
+    EXPECT_EQ(stats->liveBytes.load(), 0u);
+}
+
+TEST(TracingAllocatorTest, SizeHistogram) {
+    EXPECT_EQ(AllocationStats::bucket(1), 0u);
+    EXPECT_EQ(AllocationStats::bucket(2), 1u);
+    EXPECT_EQ(AllocationStats::bucket(5), 3u);
+    EXPECT_EQ(AllocationStats::bucket(8), 3u);
+    EXPECT_EQ(AllocationStats::bucket(std::size_t{1} << 40), AllocationStats::HistogramBuckets - 1);
+
+    using Alloc = TracingAllocator<SlabAllocator<char>>;
+    Alloc::stats().reset();
+    Alloc alloc;
+    for (std::size_t bytes : {3, 4, 100, 100, 5000}) {
+        alloc.deallocate(alloc.allocate(bytes), bytes);
+    }
+    const AllocationStats& stats = Alloc::stats();
+    EXPECT_EQ(stats.histogram[2].load(), 2u);     // 3 и 4 байта
+    EXPECT_EQ(stats.histogram[7].load(), 2u);     // 100 байт
+    EXPECT_EQ(stats.histogram[13].load(), 1u);    // 5000 байт
+    EXPECT_EQ(stats.peakBytes.load(), 5000u);
+    EXPECT_EQ(stats.chunkGrowths.load(), 2u);     // слэбы классов 16 и 128, 5000 байт - мимо слэбов
+
+    std::ostringstream out;
+    stats.report(out);
+    EXPECT_NE(out.str().find("SlabAllocator<char>"), std::string::npos);
+    EXPECT_NE(out.str().find("<=128:2"), std::string::npos);
+}
+
+TEST(TracingAllocatorTest, WrapsStackAllocator) {
+    constexpr std::size_t capacity = 1000;
+    using Pair = std::pair<const int, int>;
+    alignas(std::max_align_t) char buffer[capacity * sizeof(Pair)];
+    using StackAlloc = StackAllocator<Pair, capacity>;
+    using Alloc = TracingAllocator<StackAlloc>;
+    StatsRegistry::instance().resetAll();
+
+    std::map<int, int, std::less<>, Alloc> myMap{Alloc(StackAlloc(buffer))};
+    for (int i = 0; i < 20; ++i) {
+        myMap[i] = i;
+    }
+    AllocationStats* stats = onlyActiveStats();
+    ASSERT_NE(stats, nullptr);
+    EXPECT_NE(stats->name.find("StackAllocator"), std::string::npos);
+    EXPECT_EQ(stats->allocations.load(), 20u);
+    EXPECT_EQ(stats->chunkGrowths.load(), 0u);
+}
+
+TEST(TracingAllocatorTest, ConcurrentCounters) {
+    using Alloc = TracingAllocator<ConcurrentPoolAllocator<std::array<char, 48>>>;
+    Alloc::stats().reset();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([] {
+            Alloc alloc;
+            for (int i = 0; i < 10000; ++i) {
+                alloc.deallocate(alloc.allocate(1), 1);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(Alloc::stats().allocations.load(), 40000u);
+    EXPECT_EQ(Alloc::stats().deallocations.load(), 40000u);
+    EXPECT_EQ(Alloc::stats().liveBytes.load(), 0u);
+}
+
+TEST(TracingAllocatorTest, CompiledOutByDefault) {
+#ifdef ALLOCATOR_STATS
+    EXPECT_TRUE((std::is_same_v<MaybeTraced<PoolAllocator<int>>, TracingAllocator<PoolAllocator<int>>>));
+#else
+    EXPECT_TRUE((std::is_same_v<MaybeTraced<PoolAllocator<int>>, PoolAllocator<int>>));
+#endif
+}
+
 
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
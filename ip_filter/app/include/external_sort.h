@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "ip_filters.h"
+
+// Отсортированные в обратном порядке адреса во временном файле (упакованные ключи).
+// Файл удаляется при закрытии, читать его можно сколько угодно раз
+class SortedFile {
+private:
+    std::FILE *file = nullptr;
+    std::size_t count = 0;
+
+public:
+    SortedFile(std::FILE *file, std::size_t count) : file(file), count(count) {}
+    ~SortedFile();
+
+    SortedFile(SortedFile &&other) noexcept : file(other.file), count(other.count) { other.file = nullptr; }
+    SortedFile(const SortedFile &) = delete;
+    SortedFile &operator=(const SortedFile &) = delete;
+    SortedFile &operator=(SortedFile &&) = delete;
+
+    std::size_t size() const { return count; }
+
+    // обход всех адресов по порядку, буфер чтения - фиксированного размера
+    template <typename Func>
+    void forEach(Func func) const {
+        std::rewind(file);
+        std::vector<uint32_t> buffer(4096);
+        for (std::size_t n; (n = std::fread(buffer.data(), sizeof(uint32_t), buffer.size(), file)) > 0;) {
+            for (std::size_t i = 0; i < n; ++i) {
+                func(IPAddress::fromKey(buffer[i]));
+            }
+        }
+    }
+};
+
+// Каталог для временных файлов: $TMPDIR или /tmp
+std::string DefaultTempDir();
+
+// Временный файл в dir, удаляется автоматически при закрытии
+std::FILE *CreateTempFile(const std::string &dir);
+
+// Внешняя сортировка в обратном порядке для входа больше памяти.
+// Поток читается кусками не больше memoryBudget байт, каждый кусок сортируется
+// radix sort и дописывается в общий временный файл кусков. Затем куски сливаются
+// в несколько проходов, за проход - столько, сколько буферов чтения помещается
+// в бюджет. Открыто не больше двух временных файлов при любом числе кусков.
+// Бросает std::runtime_error, если временный файл не создать или не записать
+SortedFile ExternalSortIPAddressesRevers(IStream &io, std::size_t memoryBudget, const std::string &tempDir = DefaultTempDir());
+
+// Потоковый top-K: k наибольших адресов (с повторами) по убыванию, память O(k)
+std::vector<IPAddress> TopIPAddresses(IStream &io, std::size_t k);
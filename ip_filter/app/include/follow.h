@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "ip_filters.h"
+#include "rule_set.h"
+
+// Чтение дописываемого журнала, как tail -f: каждый poll() разбирает только
+// строки, дописанные с прошлого вызова. Недописанная последняя строка ждет
+// своего перевода строки. Если файл усечен (copytruncate) - чтение идет
+// с начала, если заменен новым файлом (переименование при ротации) - старый
+// дочитывается, его последняя строка без перевода строки разбирается как есть,
+// и открывается новый.
+class LogFollower {
+private:
+    static constexpr std::size_t ChunkSize = 1 << 20;
+
+    std::string path;
+    int fd = -1;
+    std::size_t offset = 0;     // сколько байт текущего файла уже прочитано
+    std::string pending;        // начало строки без перевода строки
+    ReadStats counters;
+
+    void open();
+    // дочитать текущий файл до конца, вернуть число новых адресов
+    std::size_t readAppended(std::vector<IPAddress> &out);
+    // разобрать pending как последнюю строку файла без перевода строки
+    std::size_t flushPending(std::vector<IPAddress> &out);
+
+public:
+    explicit LogFollower(const std::string &filePath);
+    ~LogFollower();
+
+    LogFollower(const LogFollower &) = delete;
+    LogFollower &operator=(const LogFollower &) = delete;
+
+    // добавить в out адреса из новых полных строк, вернуть их число
+    std::size_t poll(std::vector<IPAddress> &out);
+
+    const ReadStats &stats() const { return counters; }
+};
+
+// Адреса по убыванию, которые приходят отсортированными порциями. Порция
+// не сливается сразу со всем накопленным: порции лежат отдельными прогонами,
+// и соседние сливаются, только когда сравнялись по размеру (каждый следующий
+// прогон хотя бы вдвое меньше предыдущего). Так каждый адрес до снимка
+// переливается O(log n) раз, а не при каждой порции. Накопленное сливается
+// с прогонами только в sorted().
+class SortedRuns {
+private:
+    std::vector<IPAddress> merged;                // все до последнего снимка
+    std::vector<std::vector<IPAddress>> runs;     // новые порции, размеры убывают
+
+public:
+    void add(std::vector<IPAddress> run);
+
+    const std::vector<IPAddress> &sorted();
+};
+
+// Отсортированные адреса и результаты правил, которые обновляются порциями:
+// порция сортируется и проверяется правилами отдельно и откладывается прогоном,
+// с накопленными результатами прогоны сливаются при запросе снимка.
+// Уже прочитанное не разбирается и не сортируется заново.
+class IncrementalResults {
+private:
+    CompiledRuleSet rules;
+    SortedRuns all;
+    std::vector<SortedRuns> matches;   // по номеру правила
+
+public:
+    explicit IncrementalResults(CompiledRuleSet rules);
+
+    void add(const std::vector<IPAddress> &batch);
+
+    // все адреса по убыванию
+    const std::vector<IPAddress> &sorted() { return all.sorted(); }
+    std::size_t ruleCount() const { return matches.size(); }
+    // адреса, подходящие под правило id, по убыванию
+    const std::vector<IPAddress> &ruleMatches(std::size_t id) { return matches[id].sorted(); }
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "ip_filters.h"
+
+// Множество адресов в стиле roaring bitmap по упакованному ключу IPAddress::key().
+// Ключи делятся на блоки по старшим 16 битам. В каждом блоке хранятся младшие
+// 16 бит: отсортированным массивом, пока адресов не больше ArrayLimit, иначе
+// битовой картой на 65536 бит (8 КБ). Разреженные блоки занимают по 2 байта
+// на адрес, плотные - не больше 8 КБ. Проверка принадлежности - поиск блока
+// и бит либо двоичный поиск. Объединение, пересечение и разность идут
+// поблочно, плотные блоки - словами по 64 бита. Таблица блоков (256 КБ)
+// заводится у непустого множества.
+class IPBitmap {
+private:
+    // больше этого числа адресов блок хранится битовой картой (так он не больше массива)
+    static constexpr std::size_t ArrayLimit = 4096;
+    static constexpr std::size_t BitmapWords = (1 << 16) / 64;
+
+    struct Container {
+        uint16_t high = 0;
+        uint32_t cardinality = 0;
+        std::vector<uint16_t> array;   // младшие 16 бит по возрастанию, если блок не плотный
+        std::vector<uint64_t> bits;    // BitmapWords слов, если блок плотный
+
+        bool isBitmap() const { return !bits.empty(); }
+        bool contains(uint16_t low) const;
+        // перевод в подходящее по размеру представление после операции над картами
+        void normalize();
+    };
+
+    std::vector<Container> containers;   // по возрастанию high, пустых блоков нет
+    // номер блока в containers по старшим 16 битам (NoContainer - блока нет):
+    // поиск блока - одно обращение к таблице вместо двоичного поиска
+    static constexpr uint32_t NoContainer = ~uint32_t{0};
+    std::vector<uint32_t> blockIndex;
+
+    void buildIndex();
+
+    static Container makeBitmap(uint16_t high);
+    const Container *findContainer(uint16_t high) const;
+
+    static Container unite(const Container &lhs, const Container &rhs);
+    static Container intersect(const Container &lhs, const Container &rhs);
+    static Container subtract(const Container &lhs, const Container &rhs);
+
+public:
+    IPBitmap() = default;
+    // построение из адресов в любом порядке, повторы схлопываются
+    explicit IPBitmap(const std::vector<IPAddress> &ips);
+
+    bool contains(const IPAddress &ip) const;
+    void add(const IPAddress &ip);
+
+    // число различных адресов
+    std::size_t size() const;
+    bool empty() const { return containers.empty(); }
+
+    // обход в обратном порядке, как после SortIPAddressesRevers (без повторов)
+    template <typename Func>
+    void forEach(Func func) const {
+        for (auto c = containers.rbegin(); c != containers.rend(); ++c) {
+            const uint32_t high = uint32_t{c->high} << 16;
+            if (c->isBitmap()) {
+                for (std::size_t w = BitmapWords; w-- > 0;) {
+                    for (uint64_t word = c->bits[w]; word;) {
+                        const unsigned bit = 63 - static_cast<unsigned>(__builtin_clzll(word));
+                        func(IPAddress::fromKey(high | static_cast<uint32_t>(w * 64 + bit)));
+                        word &= ~(uint64_t{1} << bit);
+                    }
+                }
+            } else {
+                for (auto low = c->array.rbegin(); low != c->array.rend(); ++low) {
+                    func(IPAddress::fromKey(high | *low));
+                }
+            }
+        }
+    }
+
+    // адреса по убыванию
+    std::vector<IPAddress> toVector() const;
+
+    friend IPBitmap operator|(const IPBitmap &lhs, const IPBitmap &rhs);
+    friend IPBitmap operator&(const IPBitmap &lhs, const IPBitmap &rhs);
+    friend IPBitmap operator-(const IPBitmap &lhs, const IPBitmap &rhs);
+    bool operator==(const IPBitmap &rhs) const;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include "ip_filters.h"
+#include "ip_writer.h"
+
+// Уникальные адреса по убыванию и число повторов каждого.
+// ips можно передавать в обычные фильтры, PrefixIndex и представления,
+// а число повторов найденного адреса брать через countOf
+struct AggregatedIPs {
+    std::vector<IPAddress> ips;
+    std::vector<uint64_t> counts;
+
+    // поиск по ключу в ips, адрес может быть и копией; 0 - адреса нет
+    uint64_t countOf(const IPAddress &ip) const {
+        const auto it = std::lower_bound(ips.begin(), ips.end(), ip,
+                                         [](const IPAddress &lhs, const IPAddress &rhs) { return lhs.key() > rhs.key(); });
+        return it != ips.end() && *it == ip ? counts[static_cast<std::size_t>(it - ips.begin())] : 0;
+    }
+};
+
+// Подсчет повторов адресов: хеш-таблица с открытой адресацией по упакованному ключу
+class IPCounter {
+private:
+    std::vector<uint32_t> keys;
+    std::vector<uint64_t> counts; // 0 - ячейка свободна
+    std::size_t uniqueCount = 0;
+    uint64_t totalCount = 0;
+    unsigned shift = 0;
+
+    std::size_t slot(uint32_t key) const {
+        // мультипликативный хеш Фибоначчи, старшие биты - номер ячейки
+        return static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ull) >> shift);
+    }
+    void grow();
+
+public:
+    explicit IPCounter(std::size_t expectedUnique = 1 << 16);
+
+    void add(const IPAddress &ip, uint64_t count = 1);
+    uint64_t count(const IPAddress &ip) const;
+
+    std::size_t unique() const { return uniqueCount; }
+    uint64_t total() const { return totalCount; }
+
+    // уникальные адреса в обратном порядке с числом повторов
+    AggregatedIPs sortedRevers() const;
+};
+
+// Подсчет всех адресов потока, адреса в памяти не накапливаются
+void CountIPAddresses(IPCounter &counter, IStream &io);
+
+// Вывод адресов с колонкой числа повторов
+template <typename Range>
+void PrintIPAddressesWithCounts(const Range &ips, const AggregatedIPs &aggregated) {
+    auto &writer = StdoutWriter();
+    for (const auto &ip : ips) {
+        writer.write(ip, aggregated.countOf(ip));
+    }
+    writer.flush();
+}
@@ -9,6 +9,9 @@
 #include <cstdint>
 #include <limits>
 #include <fstream>
+#include <string_view>
+#include <charconv>
+#include <type_traits>
 
 // результат чтения IP-адреса
 enum class ReadResult {
@@ -17,108 +20,337 @@ enum class ReadResult {
     EndOfStream
 };
 
-// Класс для хранения IP-адреса
-class IPAddress {
+// Упакованный ключ адреса из Bytes байт
+template <std::size_t Bytes>
+struct AddressKey;
+template <>
+struct AddressKey<4> { using type = uint32_t; };
+template <>
+struct AddressKey<16> { using type = unsigned __int128; };
+
+// Текстовая форма IPv6 (RFC 4291, вывод - RFC 5952), реализация в ipv6.cpp.
+// FormatIPv6 пишет не больше 39 байт и возвращает конец записанного
+bool ParseIPv6(std::string_view text, std::array<uint8_t, 16> &bytes);
+char *FormatIPv6(const std::array<uint8_t, 16> &bytes, char *out);
+
+// Класс для хранения IP-адреса из Bytes байт: 4 - IPv4, 16 - IPv6
+template <std::size_t Bytes>
+class BasicIPAddress {
+    static_assert(Bytes == 4 || Bytes == 16, "only IPv4 and IPv6 addresses are supported");
 private:
-    std::array<uint8_t, 4> octets = {0, 0, 0, 0};
+    std::array<uint8_t, Bytes> octets{};
     static bool isValidOctet(int value) {
         return value >= 0 && value <= 255;
     }
 public:
-    IPAddress() = default;
-    IPAddress(uint8_t o1, uint8_t o2, uint8_t o3, uint8_t o4) : octets{o1, o2, o3, o4} {}
+    // Упакованное представление: первый октет в старших битах,
+    // поэтому числовой порядок ключей совпадает с порядком октетов
+    using Key = typename AddressKey<Bytes>::type;
+    static constexpr std::size_t ByteCount = Bytes;
 
-    friend std::ostream &operator<<(std::ostream &os, const IPAddress &ip) {
-        for (int i : {0,1,2,3}) {
-            if (i > 0) os << ".";
-            os << static_cast<int>(ip.octets[i]);
+    BasicIPAddress() = default;
+    template <typename... Octets, typename = std::enable_if_t<sizeof...(Octets) == Bytes>>
+    BasicIPAddress(Octets... o) : octets{static_cast<uint8_t>(o)...} {}
+
+    friend std::ostream &operator<<(std::ostream &os, const BasicIPAddress &ip) {
+        if constexpr (Bytes == 4) {
+            for (int i : {0,1,2,3}) {
+                if (i > 0) os << ".";
+                os << static_cast<int>(ip.octets[i]);
+            }
+        } else {
+            char text[40];
+            os.write(text, FormatIPv6(ip.octets, text) - text);
         }
         return os;
     }
 
-    friend std::istream &operator>>(std::istream &is, IPAddress &ip) {
-        int o1, o2, o3, o4;
-        char sep1, sep2, sep3;
-        if ((is >> o1 >> sep1 >> o2 >> sep2 >> o3 >> sep3 >> o4) &&
-            sep1 == '.' && sep2 == '.' && sep3 == '.' &&
-            isValidOctet(o1) && isValidOctet(o2) && isValidOctet(o3) && isValidOctet(o4)) {
-            ip.octets = {static_cast<uint8_t>(o1), static_cast<uint8_t>(o2), static_cast<uint8_t>(o3), static_cast<uint8_t>(o4)};
+    friend std::istream &operator>>(std::istream &is, BasicIPAddress &ip) {
+        if constexpr (Bytes == 4) {
+            int o1, o2, o3, o4;
+            char sep1, sep2, sep3;
+            if ((is >> o1 >> sep1 >> o2 >> sep2 >> o3 >> sep3 >> o4) &&
+                sep1 == '.' && sep2 == '.' && sep3 == '.' &&
+                isValidOctet(o1) && isValidOctet(o2) && isValidOctet(o3) && isValidOctet(o4)) {
+                ip.octets = {static_cast<uint8_t>(o1), static_cast<uint8_t>(o2), static_cast<uint8_t>(o3), static_cast<uint8_t>(o4)};
+            } else {
+                is.setstate(std::ios::failbit); 
+            }
         } else {
-            is.setstate(std::ios::failbit); 
+            std::string text;
+            std::array<uint8_t, 16> bytes;
+            if ((is >> text) && ParseIPv6(text, bytes)) {
+                ip.octets = bytes;
+            } else {
+                is.setstate(std::ios::failbit);
+            }
         }
         return is;
     }
 
-    bool operator<(const IPAddress &rhs) const { return octets < rhs.octets; }
+    Key key() const {
+        Key key = 0;
+        for (uint8_t octet : octets) {
+            key = (key << 8) | octet;
+        }
+        return key;
+    }
+    static BasicIPAddress fromBytes(const std::array<uint8_t, Bytes> &bytes) {
+        BasicIPAddress ip;
+        ip.octets = bytes;
+        return ip;
+    }
+    static BasicIPAddress fromKey(Key key) {
+        BasicIPAddress ip;
+        for (std::size_t i = Bytes; i-- > 0; key >>= 8) {
+            ip.octets[i] = static_cast<uint8_t>(key);
+        }
+        return ip;
+    }
+
+    // сравнение по ключу: одно сравнение чисел вместо побайтового
+    bool operator<(const BasicIPAddress &rhs) const { return key() < rhs.key(); }
     uint8_t operator[](size_t index) const { return octets[index]; }
-    bool operator==(const IPAddress &rhs) const { return octets == rhs.octets; }
+    bool operator==(const BasicIPAddress &rhs) const { return octets == rhs.octets; }
+    const std::array<uint8_t, Bytes> &bytes() const { return octets; }
 };
 
-// Интерфейс потока, для тестирования с помощью gmock
-class IStream {
+using IPAddress = BasicIPAddress<4>;
+using IPv6Address = BasicIPAddress<16>;
+
+// Разбор адреса из начала строки без потоков и выделения памяти:
+// пробелы в начале пропускаются, октеты - std::from_chars, 1-3 цифры и не больше 255,
+// всё после четвертого октета (табуляция и остальные поля) игнорируется
+inline bool ParseIPAddress(std::string_view text, IPAddress &ip) {
+    const char *p = text.data();
+    const char *last = p + text.size();
+    while (p != last && *p == ' ') {
+        ++p;
+    }
+    uint8_t o[4];
+    for (int i = 0; i < 4; ++i) {
+        if (i > 0) {
+            if (p == last || *p != '.') {
+                return false;
+            }
+            ++p;
+        }
+        // не больше трех цифр: переполнение невозможно, а четвертая цифра - ошибка
+        const char *digitsEnd = last - p > 3 ? p + 3 : last;
+        unsigned value = 0;
+        auto [next, ec] = std::from_chars(p, digitsEnd, value);
+        if (ec != std::errc() || value > 255 || (next != last && *next >= '0' && *next <= '9')) {
+            return false;
+        }
+        o[i] = static_cast<uint8_t>(value);
+        p = next;
+    }
+    ip = IPAddress(o[0], o[1], o[2], o[3]);
+    return true;
+}
+
+// IPv6: адрес до первого пробельного символа, формат ParseIPv6
+inline bool ParseIPAddress(std::string_view text, IPv6Address &ip) {
+    const auto first = text.find_first_not_of(' ');
+    if (first == std::string_view::npos) {
+        return false;
+    }
+    text.remove_prefix(first);
+    std::array<uint8_t, 16> bytes;
+    if (!ParseIPv6(text.substr(0, text.find_first_of(" \t\r")), bytes)) {
+        return false;
+    }
+    ip = IPv6Address::fromBytes(bytes);
+    return true;
+}
+
+// Непрерывный диапазон адресов (представление без копирования)
+class IPRange {
+private:
+    const IPAddress *first = nullptr;
+    const IPAddress *last = nullptr;
 public:
-    virtual ~IStream() = default;
-    virtual ReadResult read(IPAddress &ip) = 0;
+    IPRange() = default;
+    IPRange(const IPAddress *first, const IPAddress *last) : first(first), last(last) {}
+    IPRange(const std::vector<IPAddress> &ips) : first(ips.data()), last(ips.data() + ips.size()) {}
+
+    const IPAddress *begin() const { return first; }
+    const IPAddress *end() const { return last; }
+    std::size_t size() const { return static_cast<std::size_t>(last - first); }
+    bool empty() const { return first == last; }
+    const IPAddress &operator[](std::size_t index) const { return first[index]; }
+
+    std::vector<IPAddress> toVector() const { return std::vector<IPAddress>(first, last); }
 };
 
-// Стандартный поток ввода/вывода
-class StandardIOStream : public IStream {
+// Счетчики чтения: строки входа, отброшенные из них и прочитанные байты
+struct ReadStats {
+    std::size_t lines = 0;
+    std::size_t rejected = 0;
+    std::size_t bytes = 0;
+
+    std::size_t accepted() const { return lines - rejected; }
+};
+
+// Интерфейс потока, для тестирования с помощью gmock
+template <typename Address>
+class BasicIStream {
+protected:
+    ReadStats counters;
+
 public:
-    ReadResult read(IPAddress& ip) override {
-        std::string line;
-        if (!std::getline(std::cin, line)) {
-            return std::cin.eof() ? ReadResult::EndOfStream : ReadResult::Failure;
+    virtual ~BasicIStream() = default;
+    virtual ReadResult read(Address &ip) = 0;
+
+    // Пакетное чтение до count адресов в out, возвращает число прочитанных.
+    // Некорректные строки пропускаются, 0 означает конец потока.
+    // Потоку, который реализует только read(), строки считает эта реализация.
+    virtual std::size_t readBatch(Address *out, std::size_t count) {
+        std::size_t n = 0;
+        while (n < count) {
+            auto result = read(out[n]);
+            if (result == ReadResult::EndOfStream) {
+                break;
+            }
+            ++counters.lines;
+            if (result == ReadResult::Success) {
+                ++n;
+            } else {
+                ++counters.rejected;
+            }
         }
+        return n;
+    }
+
+    // сколько строк прочитано и отброшено с начала потока
+    const ReadStats &stats() const { return counters; }
+};
 
-        const auto tabPos = line.find('\t');
-        std::string ipText = (tabPos != std::string::npos) ? line.substr(0, tabPos) : line;
+// Пакетное чтение строк из std::istream, line - буфер строки, переживающий вызовы
+template <typename Address>
+std::size_t ReadIPAddressLines(std::istream &in, Address *out, std::size_t count, ReadStats &stats, std::string &line) {
+    std::size_t n = 0;
+    while (n < count && std::getline(in, line)) {
+        ++stats.lines;
+        stats.bytes += line.size() + 1;
+        if (ParseIPAddress(line, out[n])) {
+            ++n;
+        } else {
+            ++stats.rejected;
+        }
+    }
+    return n;
+}
 
-        std::istringstream iss(ipText);
-        return (iss >> ip) ? ReadResult::Success : ReadResult::Failure;
+// Чтение одной строки из std::istream в тот же буфер
+template <typename Address>
+ReadResult ReadIPAddressLine(std::istream &in, Address &ip, ReadStats &stats, std::string &line) {
+    if (!std::getline(in, line)) {
+        return in.eof() ? ReadResult::EndOfStream : ReadResult::Failure;
+    }
+    ++stats.lines;
+    stats.bytes += line.size() + 1;
+    if (ParseIPAddress(line, ip)) {
+        return ReadResult::Success;
+    }
+    ++stats.rejected;
+    return ReadResult::Failure;
+}
+
+// Стандартный поток ввода/вывода
+template <typename Address>
+class BasicStandardIOStream : public BasicIStream<Address> {
+private:
+    std::string line;   // буфер строки: после первых строк память больше не выделяется
+
+public:
+    ReadResult read(Address& ip) override {
+        return ReadIPAddressLine(std::cin, ip, this->counters, line);
+    }
+
+    std::size_t readBatch(Address *out, std::size_t count) override {
+        return ReadIPAddressLines(std::cin, out, count, this->counters, line);
     }
 };
 
 // Чтение IP-адресов из файла
-class FileStream : public IStream {
+template <typename Address>
+class BasicFileStream : public BasicIStream<Address> {
 private:
     std::ifstream file;
+    std::string line;   // буфер строки, общий для всех чтений
 
 public:
-    FileStream(const std::string &filePath) {
+    BasicFileStream(const std::string &filePath) {
         file.open(filePath);
         if (!file.is_open()) {
             throw std::runtime_error("Failed to open file.");
         }
     }
 
-    ReadResult read(IPAddress& ip) override {
-        std::string line;
-        
-        // Чтение строки из файла
-        if (!std::getline(file, line)) {
-            return file.eof() ? ReadResult::EndOfStream : ReadResult::Failure;
-        }
-
-        const auto tabPos = line.find('\t');
-        std::string ipText = (tabPos != std::string::npos) ? line.substr(0, tabPos) : line;
+    ReadResult read(Address& ip) override {
+        return ReadIPAddressLine(file, ip, this->counters, line);
+    }
 
-        std::istringstream iss(ipText);
-        return (iss >> ip) ? ReadResult::Success : ReadResult::Failure;
+    std::size_t readBatch(Address *out, std::size_t count) override {
+        return ReadIPAddressLines(file, out, count, this->counters, line);
     }
 };
 
+using IStream = BasicIStream<IPAddress>;
+using StandardIOStream = BasicStandardIOStream<IPAddress>;
+using FileStream = BasicFileStream<IPAddress>;
+
+using IPv6Stream = BasicIStream<IPv6Address>;
+using IPv6StandardIOStream = BasicStandardIOStream<IPv6Address>;
+using IPv6FileStream = BasicFileStream<IPv6Address>;
+
+// Размер пакета при чтении адресов
+constexpr std::size_t ReadBatchSize = 4096;
+
 // Функция загрузки IP-адресов в вектор
 void GetIPAddresses(std::vector<IPAddress> &ips, IStream &io);
 
+// Способ сортировки
+enum class SortEngine {
+    Comparison, // std::sort со сравнением октетов
+    Radix,      // LSD radix sort по упакованным ключам
+    Parallel    // разбиение по первому октету и сортировка корзин в нескольких потоках
+};
+
 // Функция сортировки IP адресов в обратном порядке
-std::vector<IPAddress> SortIPAddressesRevers(const std::vector<IPAddress> &ips);
+std::vector<IPAddress> SortIPAddressesRevers(const std::vector<IPAddress> &ips, SortEngine engine = SortEngine::Comparison);
+
+// Многопоточная сортировка в обратном порядке: 256 корзин по первому октету
+// сортируются в threads потоках и пишутся сразу в результирующий вектор
+std::vector<IPAddress> SortIPAddressesReversParallel(const std::vector<IPAddress> &ips, unsigned threads);
+
+// LSD radix sort ключей по убыванию: 4 прохода по 8 бит
+void RadixSortDescending(std::vector<uint32_t> &keys);
 
 // Фильтрация по заданному октету
 std::vector<IPAddress> FilterIPAddresses(const std::vector<IPAddress> &ips, uint8_t firstOctet, uint8_t secondOctet = 0);
 
+// Способ фильтрации по любому октету
+enum class FilterEngine {
+    Scalar, // поочередная проверка четырех октетов
+    Simd    // SSE2/AVX2, выбор по возможностям процессора
+};
+
 // Фильтрация по любому октету
-std::vector<IPAddress> FilterIPAddressesAnyOctet(const std::vector<IPAddress> &ips, uint8_t octet);
+std::vector<IPAddress> FilterIPAddressesAnyOctet(const std::vector<IPAddress> &ips, uint8_t octet, FilterEngine engine = FilterEngine::Scalar);
 
 // Функция вывода IP-адресов
 void PrintIPAddresses(const std::vector<IPAddress> &ips);
+void PrintIPAddresses(IPRange ips);
+
+// IPv6: тот же конвейер. Ключи 128-битные, radix sort - 16 проходов по 8 бит,
+// фильтры по октетам работают с байтами адреса
+void GetIPAddresses(std::vector<IPv6Address> &ips, IPv6Stream &io);
+std::vector<IPv6Address> SortIPAddressesRevers(const std::vector<IPv6Address> &ips, SortEngine engine = SortEngine::Comparison);
+std::vector<IPv6Address> SortIPAddressesReversParallel(const std::vector<IPv6Address> &ips, unsigned threads);
+void RadixSortDescending(std::vector<IPv6Address::Key> &keys);
+std::vector<IPv6Address> FilterIPAddresses(const std::vector<IPv6Address> &ips, uint8_t firstOctet, uint8_t secondOctet = 0);
+std::vector<IPv6Address> FilterIPAddressesAnyOctet(const std::vector<IPv6Address> &ips, uint8_t octet, FilterEngine engine = FilterEngine::Scalar);
+void PrintIPAddresses(const std::vector<IPv6Address> &ips);
 
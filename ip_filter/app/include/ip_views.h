@@ -0,0 +1,131 @@
+#pragma once
+
+#include <iterator>
+#include <utility>
+#include <vector>
+#include "ip_filters.h"
+#include "ip_writer.h"
+
+// Ленивые фильтры адресов. Фильтр не копирует адреса, а пропускает
+// неподходящие при обходе, поэтому фильтры можно соединять без промежуточных векторов:
+//     for (const auto &ip : sorted | views::FirstOctet(46) | views::AnyOctet(70)) ...
+// Исходный вектор должен жить, пока используется представление.
+
+namespace views {
+
+// Адаптор-фильтр, применяется к диапазону через operator|
+template <typename Predicate>
+struct FilterAdaptor {
+    Predicate pred;
+};
+
+template <typename Predicate>
+FilterAdaptor<Predicate> Filter(Predicate pred) {
+    return {std::move(pred)};
+}
+
+// first.x.x.x
+inline auto FirstOctet(uint8_t first) {
+    return Filter([first](const IPAddress &ip) { return ip[0] == first; });
+}
+
+// first.second.x.x (второй октет 0 - это 0, а не "любой")
+inline auto Prefix(uint8_t first, uint8_t second) {
+    return Filter([first, second](const IPAddress &ip) { return ip[0] == first && ip[1] == second; });
+}
+
+// octet в любой позиции
+inline auto AnyOctet(uint8_t octet) {
+    return Filter([octet](const IPAddress &ip) {
+        return ip[0] == octet || ip[1] == octet || ip[2] == octet || ip[3] == octet;
+    });
+}
+
+} // namespace views
+
+// Представление: адреса из base, для которых pred возвращает true
+template <typename Range, typename Predicate>
+class FilterView {
+private:
+    using BaseIterator = decltype(std::declval<const Range &>().begin());
+
+    Range base;
+    Predicate pred;
+
+public:
+    class iterator {
+    private:
+        BaseIterator current;
+        BaseIterator last;
+        const Predicate *pred = nullptr;
+
+        void skip() {
+            while (current != last && !(*pred)(*current)) {
+                ++current;
+            }
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = IPAddress;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const IPAddress *;
+        using reference = const IPAddress &;
+
+        iterator() = default;
+        iterator(BaseIterator current, BaseIterator last, const Predicate *pred)
+            : current(current), last(last), pred(pred) {
+            skip();
+        }
+
+        reference operator*() const { return *current; }
+        pointer operator->() const { return &*current; }
+        iterator &operator++() {
+            ++current;
+            skip();
+            return *this;
+        }
+        iterator operator++(int) {
+            iterator old = *this;
+            ++*this;
+            return old;
+        }
+        bool operator==(const iterator &other) const { return current == other.current; }
+        bool operator!=(const iterator &other) const { return current != other.current; }
+    };
+
+    FilterView(Range base, Predicate pred) : base(std::move(base)), pred(std::move(pred)) {}
+
+    iterator begin() const { return iterator(base.begin(), base.end(), &pred); }
+    iterator end() const { return iterator(base.end(), base.end(), &pred); }
+    bool empty() const { return begin() == end(); }
+
+    std::vector<IPAddress> toVector() const { return std::vector<IPAddress>(begin(), end()); }
+};
+
+template <typename Predicate>
+FilterView<IPRange, Predicate> operator|(IPRange range, views::FilterAdaptor<Predicate> adaptor) {
+    return FilterView<IPRange, Predicate>(range, std::move(adaptor.pred));
+}
+
+template <typename Predicate>
+FilterView<IPRange, Predicate> operator|(const std::vector<IPAddress> &ips, views::FilterAdaptor<Predicate> adaptor) {
+    return IPRange(ips) | std::move(adaptor);
+}
+
+// представление над временным вектором сразу стало бы висячим
+template <typename Predicate>
+void operator|(std::vector<IPAddress> &&ips, views::FilterAdaptor<Predicate> adaptor) = delete;
+
+template <typename Range, typename Predicate, typename Next>
+FilterView<FilterView<Range, Predicate>, Next> operator|(FilterView<Range, Predicate> view, views::FilterAdaptor<Next> adaptor) {
+    return FilterView<FilterView<Range, Predicate>, Next>(std::move(view), std::move(adaptor.pred));
+}
+
+// Вывод представления без промежуточного вектора
+template <typename Range, typename Predicate>
+void PrintIPAddresses(const FilterView<Range, Predicate> &view) {
+    auto &writer = StdoutWriter();
+    writer.write(view);
+    writer.flush();
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "ip_filters.h"
+
+// Текстовое представление октета: до трех цифр и длина
+struct OctetText {
+    char digits[3];
+    uint8_t length;
+};
+
+// Таблица 0..255 -> текст, заполняется один раз
+const OctetText *OctetTextTable();
+
+// Сколько байт буфера нужно FormatIPAddress для IPv4: адрес не длиннее 15 байт,
+// но каждый октет копируется тремя байтами, так что последний пишет до 16-го
+constexpr std::size_t FormatIPv4BufferSize = 16;
+
+// Запись "a.b.c.d" в out (нужно FormatIPv4BufferSize байт), возвращает конец адреса
+inline char *FormatIPAddress(const IPAddress &ip, char *out) {
+    static const OctetText *table = OctetTextTable();
+    for (int i = 0; i < 4; ++i) {
+        const OctetText &text = table[ip[i]];
+        std::memcpy(out, text.digits, 3);
+        out += text.length;
+        *out++ = '.';
+    }
+    return out - 1;
+}
+
+// Запись IPv6 в сокращенной форме (RFC 5952, не больше 39 байт)
+inline char *FormatIPAddress(const IPv6Address &ip, char *out) {
+    return FormatIPv6(ip.bytes(), out);
+}
+
+// Буферизованный вывод адресов: строки собираются в буфере и пишутся
+// одним fwrite на буфер, без форматирования iostream на каждый октет
+class IPAddressWriter {
+private:
+    // "ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff\t18446744073709551615\n"
+    static constexpr std::size_t MaxLineLength = 61;
+    // для IPv4: буфер FormatIPAddress, табуляция, 20 цифр счетчика и перевод строки
+    static_assert(FormatIPv4BufferSize + 22 <= MaxLineLength, "MaxLineLength is too small for IPv4 lines");
+
+    std::FILE *out;
+    std::vector<char> buffer;
+    std::size_t used = 0;
+
+public:
+    explicit IPAddressWriter(std::FILE *out, std::size_t bufferSize = 1 << 16);
+    ~IPAddressWriter();
+
+    IPAddressWriter(const IPAddressWriter &) = delete;
+    IPAddressWriter &operator=(const IPAddressWriter &) = delete;
+
+    template <std::size_t Bytes>
+    void write(const BasicIPAddress<Bytes> &ip) {
+        if (buffer.size() - used < MaxLineLength) {
+            flush();
+        }
+        char *end = FormatIPAddress(ip, buffer.data() + used);
+        *end++ = '\n';
+        used = static_cast<std::size_t>(end - buffer.data());
+    }
+
+    // адрес и через табуляцию число повторов
+    template <std::size_t Bytes>
+    void write(const BasicIPAddress<Bytes> &ip, uint64_t count) {
+        if (buffer.size() - used < MaxLineLength) {
+            flush();
+        }
+        char *end = FormatIPAddress(ip, buffer.data() + used);
+        *end++ = '\t';
+        end = std::to_chars(end, buffer.data() + buffer.size(), count).ptr;
+        *end++ = '\n';
+        used = static_cast<std::size_t>(end - buffer.data());
+    }
+
+    // любой диапазон адресов: вектор, IPRange, FilterView
+    template <typename Range>
+    void write(const Range &ips) {
+        for (const auto &ip : ips) {
+            write(ip);
+        }
+    }
+
+    // сбросить буфер в файл
+    void flush();
+};
+
+// Общий буферизованный вывод в stdout, буфер переиспользуется между вызовами
+IPAddressWriter &StdoutWriter();
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "ip_filters.h"
+
+// Разбор IP-адреса из строки [first, last): ParseIPAddress для пары указателей.
+// Строка вида "a.b.c.d[\t...]", всё после четвертого октета игнорируется.
+bool ParseIPLine(const char *first, const char *last, IPAddress &ip);
+
+// Обычный ли файл по пути: канал, FIFO, /dev/stdin и <(...) не отображаются
+// в память и читаются потоком
+bool IsRegularFile(const std::string &filePath);
+
+// Файл, отображенный в память только для чтения
+class MappedFile {
+private:
+    const char *first = nullptr;
+    std::size_t length = 0;
+
+public:
+    // sequential - подсказка ядру, что файл читается подряд;
+    // бросает std::runtime_error, если файл не обычный
+    explicit MappedFile(const std::string &filePath, bool sequential = true);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data() const { return first; }
+    const char *end() const { return first + length; }
+    std::size_t size() const { return length; }
+};
+
+// Чтение IP-адресов из файла, отображенного в память (mmap).
+// Адреса разбираются прямо из отображенных байт, без getline и istringstream.
+class MappedFileStream : public IStream {
+private:
+    // меньше этого на поток файл не делится
+    static constexpr std::size_t MinBytesPerThread = 1 << 16;
+
+    MappedFile file;
+    const char *pos = nullptr;   // текущая позиция чтения
+
+public:
+    explicit MappedFileStream(const std::string &filePath) : file(filePath), pos(file.data()) {}
+
+    ReadResult read(IPAddress &ip) override;
+    std::size_t readBatch(IPAddress *out, std::size_t count) override;
+
+    // Разбор всего оставшегося файла в threads потоков: файл делится на куски
+    // по границам строк, куски разбираются параллельно и склеиваются по порядку,
+    // результат совпадает с последовательным чтением.
+    // Поток создается только над обычным файлом, поэтому размер отображения -
+    // весь файл, и пустой результат означает пустой файл, а не канал
+    void readAll(std::vector<IPAddress> &ips, unsigned threads);
+
+    // размер отображенного файла в байтах
+    std::size_t bytes() const { return file.size(); }
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// Число рабочих потоков по умолчанию
+inline unsigned DefaultThreadCount() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Запуск func(index) в threads потоках, index от 0 до threads - 1.
+// Поток с индексом 0 - вызывающий, остальные создаются и дожидаются здесь же.
+template <typename Func>
+void ParallelFor(unsigned threads, Func func) {
+    std::vector<std::thread> workers;
+    workers.reserve(threads > 0 ? threads - 1 : 0);
+    for (unsigned i = 1; i < threads; ++i) {
+        workers.emplace_back(func, i);
+    }
+    func(0u);
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ip_filters.h"
+
+// Пиковое потребление памяти процессом (RSS) в байтах
+std::size_t PeakRSSBytes();
+
+// Замеры конвейера для --stats: время каждой стадии, счетчики чтения
+// и пиковая память. Отчет - одна строка JSON, например
+// {"mode":"in-memory","stages":{"read":0.012,...},"total_seconds":0.05,
+//  "lines":{"read":1000,"accepted":998,"rejected":2},"bytes":16384,"peak_rss_bytes":4194304}
+class PipelineStats {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point started = Clock::now();
+    std::vector<std::pair<std::string, double>> stages;   // в порядке выполнения
+
+public:
+    // выполнить стадию и запомнить ее время в секундах,
+    // время повторяющейся стадии (например, в цикле --follow) суммируется
+    template <typename Func>
+    void measure(const std::string &stage, Func func) {
+        const auto start = Clock::now();
+        func();
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        auto it = std::find_if(stages.begin(), stages.end(), [&](const auto &s) { return s.first == stage; });
+        if (it != stages.end()) {
+            it->second += seconds;
+        } else {
+            stages.emplace_back(stage, seconds);
+        }
+    }
+
+    const std::vector<std::pair<std::string, double>> &stageTimes() const { return stages; }
+
+    // отчет в out, обычно stderr, чтобы не смешивать со списком адресов в stdout
+    void report(std::FILE *out, const std::string &mode, const ReadStats &read) const;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+#include "ip_filters.h"
+
+// Индекс префиксов по отсортированному в обратном порядке вектору адресов.
+// Строится один раз за O(n), запросы по первому или первым двум октетам
+// отдают непрерывный поддиапазон за O(1) без копирования.
+// Вектор должен жить и не меняться, пока используется индекс.
+class PrefixIndex {
+public:
+    static constexpr std::size_t TableSize = 1 << 16;
+
+private:
+    const IPAddress *data = nullptr;
+    // offsets[k] - начало адресов с префиксом из двух октетов 0xFFFF - k,
+    // диапазон префикса: [offsets[k], offsets[k + 1]).
+    // Таблица по первому октету не нужна: его 256 префиксов идут в ней подряд.
+    // Таблица своя (storage) или внешняя, например из отображенного снимка
+    std::vector<uint64_t> storage;
+    const uint64_t *external = nullptr;
+
+    const uint64_t *offsets() const { return external ? external : storage.data(); }
+
+    IPRange slice(std::size_t from, std::size_t to) const {
+        return IPRange(data + offsets()[from], data + offsets()[to]);
+    }
+
+public:
+    explicit PrefixIndex(IPRange sorted);
+
+    // индекс по готовой таблице из TableSize + 1 смещений, таблица не копируется
+    PrefixIndex(IPRange sorted, const uint64_t *table) : data(sorted.begin()), external(table) {}
+
+    // таблица смещений, TableSize + 1 элементов
+    const uint64_t *table() const { return offsets(); }
+
+    // адреса first.x.x.x
+    IPRange find(uint8_t first) const {
+        const std::size_t k = TableSize - 1 - (static_cast<std::size_t>(first) << 8 | 0xFF);
+        return slice(k, k + 256);
+    }
+
+    // адреса first.second.x.x
+    IPRange find(uint8_t first, uint8_t second) const {
+        const std::size_t k = TableSize - 1 - (static_cast<std::size_t>(first) << 8 | second);
+        return slice(k, k + 1);
+    }
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <initializer_list>
+#include <string_view>
+#include <vector>
+#include "ip_filters.h"
+#include "ip_views.h"
+
+// Диапазон адресов [low, high] по упакованным ключам IPAddress::key()
+struct AddressRange {
+    uint32_t low = 0;
+    uint32_t high = 0;
+
+    bool contains(const IPAddress &ip) const {
+        const uint32_t key = ip.key();
+        return key >= low && key <= high;
+    }
+    bool operator==(const AddressRange &rhs) const { return low == rhs.low && high == rhs.high; }
+
+    // сеть base/prefixLength, биты адреса за маской отбрасываются
+    static AddressRange cidr(const IPAddress &base, unsigned prefixLength);
+};
+
+// Разбор правила: "10.0.0.0/8", "1.2.3.4-1.2.3.9" или один адрес "1.2.3.4".
+// При ошибке бросает std::invalid_argument
+AddressRange ParseAddressRange(std::string_view text);
+
+// Запрос из списка диапазонов. Диапазоны объединяются, поэтому пересечения
+// не дают повторов, а результат идет в том же обратном порядке, что и сортировка
+class RangeQuery {
+private:
+    // объединенные непересекающиеся диапазоны по убыванию
+    std::vector<AddressRange> merged;
+
+public:
+    RangeQuery() = default;
+    RangeQuery(std::initializer_list<std::string_view> rules);
+
+    RangeQuery &add(const AddressRange &range);
+    RangeQuery &add(std::string_view rule) { return add(ParseAddressRange(rule)); }
+
+    const std::vector<AddressRange> &ranges() const { return merged; }
+
+    // попадает ли адрес хотя бы в один диапазон, двоичный поиск по диапазонам
+    bool matches(const IPAddress &ip) const;
+
+    // подходящие адреса отсортированного в обратном порядке вектора:
+    // по непрерывному поддиапазону на каждый диапазон запроса, двоичным поиском
+    std::vector<IPRange> find(IPRange sorted) const;
+
+    // то же, но одним вектором
+    std::vector<IPAddress> filter(IPRange sorted) const;
+};
+
+namespace views {
+
+// адреса, попадающие в запрос
+inline auto InRanges(RangeQuery query) {
+    return Filter([query = std::move(query)](const IPAddress &ip) { return query.matches(ip); });
+}
+
+} // namespace views
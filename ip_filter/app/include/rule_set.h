@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ip_filters.h"
+#include "range_query.h"
+
+// Вид правила фильтрации
+enum class RuleKind {
+    Prefix,   // first.x.x.x или first.second.x.x
+    AnyOctet, // октет в любой позиции
+    Range     // CIDR, диапазон a-b или один адрес
+};
+
+// Одно правило фильтрации. Префикс хранится как диапазон ключей
+struct FilterRule {
+    RuleKind kind = RuleKind::Range;
+    AddressRange range;
+    uint8_t octet = 0;
+
+    static FilterRule prefix(uint8_t first);
+    static FilterRule prefix(uint8_t first, uint8_t second);
+    static FilterRule anyOctet(uint8_t octet);
+    static FilterRule inRange(const AddressRange &range);
+
+    // проверка одного адреса, без скомпилированных таблиц
+    bool matches(const IPAddress &ip) const;
+};
+
+// Разбор правила: "prefix 46", "prefix 46.70", "any 46", "range 10.0.0.0/8"
+// (для range - любой формат ParseAddressRange). При ошибке бросает std::invalid_argument
+FilterRule ParseFilterRule(std::string_view text);
+
+class CompiledRuleSet;
+
+// Набор правил: правила регистрируются заранее и получают номера по порядку,
+// затем набор компилируется и проверяется за один проход по адресам
+class RuleSet {
+private:
+    std::vector<FilterRule> rules;
+
+public:
+    RuleSet() = default;
+    RuleSet(std::initializer_list<std::string_view> rules);
+
+    // добавить правило, возвращает его номер
+    std::size_t add(const FilterRule &rule);
+    std::size_t add(std::string_view rule) { return add(ParseFilterRule(rule)); }
+
+    std::size_t size() const { return rules.size(); }
+    const FilterRule &operator[](std::size_t index) const { return rules[index]; }
+
+    CompiledRuleSet compile() const;
+};
+
+// Правила из файла: по одному на строку, пустые строки и "#..." пропускаются
+RuleSet LoadRuleSet(const std::string &path);
+
+// Скомпилированный набор. Правила раскладываются по таблице старших 16 бит адреса:
+// для каждой пары first.second заранее известны правила, которые совпадают целиком
+// (префиксы, any по первым двум октетам, диапазоны, покрывающие весь блок), и диапазоны,
+// задевающие блок частично. Any по третьему и четвертому октету - таблица по значению октета.
+// Поэтому на адрес уходит один-два поиска в таблицах, а не проверка всех правил
+class CompiledRuleSet {
+private:
+    static constexpr std::size_t BlockCount = 1 << 16;
+
+    std::vector<FilterRule> rules;
+    // списки номеров правил в общем массиве: start[k]..start[k + 1]
+    std::vector<uint32_t> fullStart;
+    std::vector<uint16_t> fullRules;
+    std::vector<uint32_t> partialStart;
+    std::vector<uint16_t> partialRules;
+    std::array<std::vector<uint16_t>, 256> octetRules;
+
+public:
+    explicit CompiledRuleSet(std::vector<FilterRule> rules);
+
+    std::size_t size() const { return rules.size(); }
+
+    // адреса для каждого правила (по номеру правила), в порядке входа:
+    // для отсортированного входа результаты тоже отсортированы
+    std::vector<std::vector<IPAddress>> evaluate(IPRange ips) const;
+};
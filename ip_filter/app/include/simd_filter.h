@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "ip_filters.h"
+
+// Набор инструкций для фильтрации
+enum class SimdLevel {
+    Scalar,
+    SSE2, // 16 байт = 4 адреса IPv4 (1 адрес IPv6) за сравнение
+    AVX2  // 32 байта = 8 адресов IPv4 (2 адреса IPv6) за сравнение
+};
+
+// Лучший доступный на этом процессоре уровень (определяется один раз)
+SimdLevel DetectSimdLevel();
+
+// Фильтрация по любому октету: побайтовое сравнение сразу нескольких адресов
+// и movemask, результат совпадает с FilterIPAddressesAnyOctet.
+// Уровень выше доступного понижается до доступного.
+std::vector<IPAddress> FilterIPAddressesAnyOctetSimd(const std::vector<IPAddress> &ips, uint8_t octet, SimdLevel level);
+std::vector<IPv6Address> FilterIPAddressesAnyOctetSimd(const std::vector<IPv6Address> &ips, uint8_t octet, SimdLevel level);
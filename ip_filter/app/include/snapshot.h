@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include "ip_filters.h"
+#include "mapped_stream.h"
+#include "prefix_index.h"
+
+// Бинарный снимок разобранного набора адресов:
+//   SnapshotHeader
+//   count адресов по 4 байта, отсортированы по убыванию: октеты по порядку,
+//     то есть big-endian uint32_t ключи, совпадающие с раскладкой IPAddress
+//   выравнивание до 8 байт
+//   необязательно: таблица PrefixIndex, TableSize + 1 смещений uint64_t
+// Поля заголовка и таблица - в порядке байт записавшей машины.
+// Снимок отображается в память как есть, без разбора и копирования.
+struct SnapshotHeader {
+    char magic[8];          // "IPFSNAP\0"
+    uint32_t version;
+    uint32_t flags;
+    uint64_t count;         // число адресов
+    uint64_t indexOffset;   // смещение таблицы индекса от начала файла, 0 - индекса нет
+};
+
+constexpr uint32_t SnapshotVersion = 1;
+constexpr uint32_t SnapshotHasIndex = 1;
+
+// Запись снимка, sorted - отсортированы по убыванию
+void WriteSnapshot(const std::string &path, IPRange sorted, bool withIndex = true);
+
+// Снимок, отображенный в память
+class Snapshot {
+private:
+    MappedFile file;
+    const SnapshotHeader *header = nullptr;
+    IPRange ips;
+
+public:
+    // бросает std::runtime_error, если файл не снимок или поврежден
+    explicit Snapshot(const std::string &path);
+
+    // отсортированные по убыванию адреса прямо из отображения
+    IPRange addresses() const { return ips; }
+    bool hasIndex() const { return header->indexOffset != 0; }
+
+    // индекс из снимка без копирования, если он там есть, иначе строится заново
+    PrefixIndex index() const;
+};
+
+// Поток адресов из снимка, чтобы существующие функции работали и с ним
+class SnapshotStream : public IStream {
+private:
+    Snapshot snapshot;
+    const IPAddress *pos;
+
+public:
+    explicit SnapshotStream(const std::string &path) : snapshot(path), pos(snapshot.addresses().begin()) {}
+
+    ReadResult read(IPAddress &ip) override {
+        if (pos == snapshot.addresses().end()) {
+            return ReadResult::EndOfStream;
+        }
+        ip = *pos++;
+        ++counters.lines;
+        counters.bytes += sizeof(IPAddress);
+        return ReadResult::Success;
+    }
+
+    std::size_t readBatch(IPAddress *out, std::size_t count) override {
+        const std::size_t n = std::min(count, static_cast<std::size_t>(snapshot.addresses().end() - pos));
+        std::copy(pos, pos + n, out);
+        pos += n;
+        counters.lines += n;
+        counters.bytes += n * sizeof(IPAddress);
+        return n;
+    }
+};
@@ -1,30 +1,327 @@
 #include "ip_filters.h"
-    
+#include "mapped_stream.h"
+#include "prefix_index.h"
+#include "ip_views.h"
+#include "ip_writer.h"
+#include "external_sort.h"
+#include "ip_counter.h"
+#include "parallel.h"
+#include "snapshot.h"
+#include "pipeline_stats.h"
+#include "rule_set.h"
+#include "follow.h"
+#include <chrono>
+#include <csignal>
+#include <thread>
+#include <memory>
 
-int main(int argc, char *argv[]) {
-    std::vector<IPAddress> ips;
-    IStream *io;
-    if (argc > 1) {
-        io = new FileStream (argv[1]);
-    } else {
-        //std::cout << "Enter IP addresses. To finish, press Ctrl+D (Ctrl+Z on Windows)." << std::endl;
-        io = new StandardIOStream ();
-    }
-
-    GetIPAddresses(ips, *io);
-
-    //сортировка в обратном порядке
-    auto sorted = SortIPAddressesRevers(ips);
+// Вывод отсортированных адресов и результатов фильтров
+void PrintResults(IPRange sorted, const PrefixIndex &index) {
     //вывод отсортированных адресов
     PrintIPAddresses(sorted);
     //1.x.x.x
-    auto filtered = FilterIPAddresses(sorted, 1);
-    PrintIPAddresses(filtered);
+    PrintIPAddresses(index.find(1));
     //46.70.x.x
-    filtered = FilterIPAddresses(sorted, 46, 70);
-    PrintIPAddresses(filtered);
+    PrintIPAddresses(index.find(46, 70));
     //любой октет 46.
-    filtered = FilterIPAddressesAnyOctet(sorted, 46);
-    PrintIPAddresses(filtered);
+    PrintIPAddresses(sorted | views::AnyOctet(46));
+    // в замер стадии вывода входит и запись буфера stdio
+    std::fflush(stdout);
+}
+
+// Вместо трех фильтров по умолчанию - правила из --rules, все за один проход
+void PrintRuleResults(IPRange sorted, const RuleSet &rules, PipelineStats &stats) {
+    std::vector<std::vector<IPAddress>> matches;
+    stats.measure("filter", [&] { matches = rules.compile().evaluate(sorted); });
+    stats.measure("print", [&] {
+        PrintIPAddresses(sorted);
+        for (const auto &ips : matches) {
+            PrintIPAddresses(ips);
+        }
+        std::fflush(stdout);
+    });
+}
+
+// Все адреса в памяти, при необходимости сохраняем снимок
+void RunInMemory(IStream &io, const std::string &snapshotPath, const RuleSet &rules, PipelineStats &stats) {
+    std::vector<IPAddress> ips;
+    stats.measure("read", [&] {
+        //обычный файл разбираем параллельно; MappedFileStream бывает только над
+        //обычным файлом, канал, FIFO и stdin читаются пакетами
+        auto *mapped = dynamic_cast<MappedFileStream *>(&io);
+        if (mapped && mapped->bytes() > 0) {
+            mapped->readAll(ips, DefaultThreadCount());
+        } else {
+            GetIPAddresses(ips, io);
+        }
+    });
+
+    //сортировка в обратном порядке
+    std::vector<IPAddress> sorted;
+    stats.measure("sort", [&] { sorted = SortIPAddressesRevers(ips, SortEngine::Radix); });
+    //исходный порядок больше не нужен, освобождаем память
+    std::vector<IPAddress>().swap(ips);
+    if (!snapshotPath.empty()) {
+        stats.measure("write_snapshot", [&] { WriteSnapshot(snapshotPath, sorted); });
+    }
+    if (rules.size() > 0) {
+        PrintRuleResults(sorted, rules, stats);
+        return;
+    }
+    //индекс префиксов по отсортированным адресам
+    std::unique_ptr<PrefixIndex> index;
+    stats.measure("index", [&] { index = std::make_unique<PrefixIndex>(sorted); });
+    stats.measure("print", [&] { PrintResults(sorted, *index); });
+}
+
+// Готовый снимок: без разбора и сортировки
+ReadStats RunSnapshot(const std::string &snapshotPath, const RuleSet &rules, PipelineStats &stats) {
+    std::unique_ptr<Snapshot> snapshot;
+    stats.measure("map", [&] { snapshot = std::make_unique<Snapshot>(snapshotPath); });
+    if (rules.size() > 0) {
+        PrintRuleResults(snapshot->addresses(), rules, stats);
+    } else {
+        stats.measure("print", [&] { PrintResults(snapshot->addresses(), snapshot->index()); });
+    }
+
+    ReadStats read;
+    read.lines = snapshot->addresses().size();
+    read.bytes = read.lines * sizeof(IPAddress);
+    return read;
+}
+
+// Внешняя сортировка: в памяти не больше memoryBudget байт,
+// фильтры - отдельными проходами по отсортированному временному файлу
+void RunExternal(IStream &io, std::size_t memoryBudget, PipelineStats &stats) {
+    std::unique_ptr<SortedFile> sorted;
+    // чтение входа и сортировка отрезков в одной стадии
+    stats.measure("read_sort", [&] {
+        sorted = std::make_unique<SortedFile>(ExternalSortIPAddressesRevers(io, memoryBudget));
+    });
+    auto &writer = StdoutWriter();
+    auto printIf = [&](auto pred) {
+        sorted->forEach([&](const IPAddress &ip) {
+            if (pred(ip)) {
+                writer.write(ip);
+            }
+        });
+        writer.flush();
+    };
+    stats.measure("print", [&] {
+        printIf([](const IPAddress &) { return true; });
+        printIf(views::FirstOctet(1).pred);
+        printIf(views::Prefix(46, 70).pred);
+        printIf(views::AnyOctet(46).pred);
+        std::fflush(stdout);
+    });
+}
+
+// Уникальные адреса с числом повторов
+void RunAggregated(IStream &io, PipelineStats &stats) {
+    IPCounter counter;
+    stats.measure("read_count", [&] { CountIPAddresses(counter, io); });
+    AggregatedIPs aggregated;
+    stats.measure("sort", [&] { aggregated = counter.sortedRevers(); });
+    const auto &sorted = aggregated.ips;
+
+    stats.measure("print", [&] {
+        PrintIPAddressesWithCounts(sorted, aggregated);
+        PrefixIndex index(sorted);
+        PrintIPAddressesWithCounts(index.find(1), aggregated);
+        PrintIPAddressesWithCounts(index.find(46, 70), aggregated);
+        PrintIPAddressesWithCounts(sorted | views::AnyOctet(46), aggregated);
+        std::fflush(stdout);
+    });
+}
+
+// Только top наибольших адресов
+void RunTop(IStream &io, std::size_t top, PipelineStats &stats) {
+    std::vector<IPAddress> largest;
+    stats.measure("read_select", [&] { largest = TopIPAddresses(io, top); });
+    stats.measure("print", [&] {
+        PrintIPAddresses(largest);
+        std::fflush(stdout);
+    });
+}
+
+// IPv6: тот же конвейер в памяти, фильтры по байтам адреса
+void RunIPv6(IPv6Stream &io, PipelineStats &stats) {
+    std::vector<IPv6Address> ips;
+    stats.measure("read", [&] { GetIPAddresses(ips, io); });
+    std::vector<IPv6Address> sorted;
+    stats.measure("sort", [&] { sorted = SortIPAddressesRevers(ips, SortEngine::Radix); });
+    std::vector<IPv6Address>().swap(ips);
+
+    stats.measure("print", [&] {
+        PrintIPAddresses(sorted);
+        PrintIPAddresses(FilterIPAddresses(sorted, 1));
+        PrintIPAddresses(FilterIPAddresses(sorted, 46, 70));
+        PrintIPAddresses(FilterIPAddressesAnyOctet(sorted, 46, FilterEngine::Simd));
+        std::fflush(stdout);
+    });
+}
+
+// сигнал остановки для режима --follow
+volatile std::sig_atomic_t stopFollowing = 0;
+
+// Слежение за дописываемым журналом: новые строки разбираются каждые pollInterval,
+// результаты (все адреса и правила) выводятся раз в interval и при остановке (SIGINT/SIGTERM).
+// Каждый снимок начинается строкой "# snapshot N: M addresses"
+ReadStats RunFollow(const std::string &filePath, const RuleSet &rules, std::chrono::seconds interval, PipelineStats &stats) {
+    constexpr auto pollInterval = std::chrono::milliseconds(200);
+    std::signal(SIGINT, [](int) { stopFollowing = 1; });
+    std::signal(SIGTERM, [](int) { stopFollowing = 1; });
+
+    LogFollower follower(filePath);
+    IncrementalResults results(rules.compile());
+    std::vector<IPAddress> batch;
+    std::size_t snapshots = 0;
+    auto nextSnapshot = std::chrono::steady_clock::now();
+    for (;;) {
+        const bool stopping = stopFollowing != 0;
+        batch.clear();
+        stats.measure("read", [&] { follower.poll(batch); });
+        stats.measure("merge", [&] { results.add(batch); });
+
+        const auto now = std::chrono::steady_clock::now();
+        if (stopping || now >= nextSnapshot) {
+            stats.measure("print", [&] {
+                std::printf("# snapshot %zu: %zu addresses\n", ++snapshots, results.sorted().size());
+                PrintIPAddresses(results.sorted());
+                for (std::size_t id = 0; id < results.ruleCount(); ++id) {
+                    PrintIPAddresses(results.ruleMatches(id));
+                }
+                std::fflush(stdout);
+            });
+            nextSnapshot = now + interval;
+        }
+        if (stopping) {
+            return follower.stats();
+        }
+        std::this_thread::sleep_for(pollInterval);
+    }
+}
+
+// ip_filter [--memory-limit=МБ] [--top=N] [--aggregate] [--write-snapshot=файл] [--rules=файл] [--stats] [файл]
+// ip_filter --snapshot=файл [--rules=файл] [--stats]
+// ip_filter --ipv6 [--stats] [файл]
+// ip_filter --follow [--interval=секунды] [--rules=файл] [--stats] файл
+// --rules: файл правил (см. ParseFilterRule), заменяет фильтры по умолчанию в режиме в памяти и для снимка
+// --stats: время стадий, счетчики строк, байты и пиковая память - строкой JSON в stderr
+int Run(int argc, char *argv[]) {
+    std::string filePath;
+    std::size_t memoryLimit = 0;
+    std::size_t top = 0;
+    bool aggregate = false;
+    bool ipv6 = false;
+    bool printStats = false;
+    bool follow = false;
+    long interval = 60;
+    std::string snapshotPath;
+    std::string writeSnapshotPath;
+    RuleSet rules;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.rfind("--memory-limit=", 0) == 0) {
+            memoryLimit = std::stoul(arg.substr(15)) << 20;
+        } else if (arg.rfind("--top=", 0) == 0) {
+            top = std::stoul(arg.substr(6));
+        } else if (arg.rfind("--snapshot=", 0) == 0) {
+            snapshotPath = arg.substr(11);
+        } else if (arg.rfind("--write-snapshot=", 0) == 0) {
+            writeSnapshotPath = arg.substr(17);
+        } else if (arg.rfind("--rules=", 0) == 0) {
+            rules = LoadRuleSet(arg.substr(8));
+        } else if (arg == "--aggregate") {
+            aggregate = true;
+        } else if (arg == "--ipv6") {
+            ipv6 = true;
+        } else if (arg == "--follow") {
+            follow = true;
+        } else if (arg.rfind("--interval=", 0) == 0) {
+            interval = std::stol(arg.substr(11));
+        } else if (arg == "--stats") {
+            printStats = true;
+        } else {
+            filePath = arg;
+        }
+    }
+
+    PipelineStats stats;
+    if (!snapshotPath.empty()) {
+        const ReadStats read = RunSnapshot(snapshotPath, rules, stats);
+        if (printStats) {
+            stats.report(stderr, "snapshot", read);
+        }
+        return 0;
+    }
+
+    if (follow) {
+        if (filePath.empty()) {
+            throw std::invalid_argument("--follow needs a file.");
+        }
+        // по умолчанию те же фильтры, что и при обычном запуске
+        if (rules.size() == 0) {
+            rules = RuleSet{"prefix 1", "prefix 46.70", "any 46"};
+        }
+        const ReadStats read = RunFollow(filePath, rules, std::chrono::seconds(interval), stats);
+        if (printStats) {
+            stats.report(stderr, "follow", read);
+        }
+        return 0;
+    }
+
+    if (ipv6) {
+        std::unique_ptr<IPv6Stream> io;
+        if (!filePath.empty()) {
+            io = std::make_unique<IPv6FileStream>(filePath);
+        } else {
+            io = std::make_unique<IPv6StandardIOStream>();
+        }
+        RunIPv6(*io, stats);
+        if (printStats) {
+            stats.report(stderr, "ipv6", io->stats());
+        }
+        return 0;
+    }
+
+    std::unique_ptr<IStream> io;
+    if (!filePath.empty() && IsRegularFile(filePath)) {
+        io = std::make_unique<MappedFileStream>(filePath);
+    } else if (!filePath.empty()) {
+        // канал или FIFO не отображается в память, читаем потоком
+        io = std::make_unique<FileStream>(filePath);
+    } else {
+        //std::cout << "Enter IP addresses. To finish, press Ctrl+D (Ctrl+Z on Windows)." << std::endl;
+        io = std::make_unique<StandardIOStream>();
+    }
+
+    std::string mode;
+    if (top > 0) {
+        mode = "top";
+        RunTop(*io, top, stats);
+    } else if (aggregate) {
+        mode = "aggregate";
+        RunAggregated(*io, stats);
+    } else if (memoryLimit > 0) {
+        mode = "external";
+        RunExternal(*io, memoryLimit, stats);
+    } else {
+        mode = "in-memory";
+        RunInMemory(*io, writeSnapshotPath, rules, stats);
+    }
+    if (printStats) {
+        stats.report(stderr, mode, io->stats());
+    }
     return 0;
-}
\ No newline at end of file
+}
+
+int main(int argc, char *argv[]) {
+    // ошибки ввода, временных файлов и аргументов - сообщением, а не std::terminate
+    try {
+        return Run(argc, argv);
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "ip_filter: %s\n", e.what());
+        return 1;
+    }
+}
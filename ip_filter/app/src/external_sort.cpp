@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <memory>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <unistd.h>
+#include "external_sort.h"
+
+namespace {
+
+// на адрес в куске: сам адрес, ключ и буфер radix sort
+constexpr std::size_t BytesPerAddress = sizeof(IPAddress) + 2 * sizeof(uint32_t);
+constexpr std::size_t MinChunkSize = 1024;
+// ключей в буфере чтения куска при слиянии, не меньше
+constexpr std::size_t MinReadBuffer = 1024;
+// больше кусков за проход не сливаем: куча и буферы остаются маленькими
+constexpr std::size_t MaxFanIn = 256;
+
+using TempFile = std::unique_ptr<std::FILE, int (*)(std::FILE *)>;
+
+TempFile createTempFile(const std::string &dir) {
+    return TempFile(CreateTempFile(dir), &std::fclose);
+}
+
+void writeKeys(std::FILE *file, const std::vector<uint32_t> &keys) {
+    if (std::fwrite(keys.data(), sizeof(uint32_t), keys.size(), file) != keys.size()) {
+        throw std::runtime_error("Failed to write temporary file.");
+    }
+}
+
+// отсортированный кусок: отрезок общего файла кусков, в ключах
+struct Run {
+    std::size_t offset;
+    std::size_t count;
+};
+
+// буферизованное чтение одного куска при слиянии; все куски читаются
+// через pread из одного файла, так что открытых файлов не больше двух
+class RunReader {
+private:
+    int fd;
+    std::size_t pos;      // следующий непрочитанный ключ куска
+    std::size_t end;
+    std::vector<uint32_t> buffer;
+    std::size_t bufferPos = 0;
+    std::size_t bufferSize = 0;
+
+public:
+    RunReader(std::FILE *file, const Run &run, std::size_t bufferKeys)
+        : fd(::fileno(file)), pos(run.offset), end(run.offset + run.count), buffer(std::min(bufferKeys, run.count)) {}
+
+    bool next(uint32_t &key) {
+        if (bufferPos == bufferSize) {
+            bufferSize = std::min(buffer.size(), end - pos);
+            bufferPos = 0;
+            if (bufferSize == 0) {
+                return false;
+            }
+            char *out = reinterpret_cast<char *>(buffer.data());
+            std::size_t bytes = bufferSize * sizeof(uint32_t);
+            off_t offset = static_cast<off_t>(pos * sizeof(uint32_t));
+            while (bytes > 0) {
+                const ssize_t n = ::pread(fd, out, bytes, offset);
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    throw std::runtime_error("Failed to read temporary file.");
+                }
+                out += n;
+                bytes -= static_cast<std::size_t>(n);
+                offset += n;
+            }
+            pos += bufferSize;
+        }
+        key = buffer[bufferPos++];
+        return true;
+    }
+};
+
+// слияние кусков в конец out: куча по текущему ключу каждого куска
+void mergeRuns(std::FILE *in, const Run *first, const Run *last, std::FILE *out, std::size_t bufferKeys) {
+    std::vector<RunReader> readers;
+    readers.reserve(static_cast<std::size_t>(last - first));
+    using Head = std::pair<uint32_t, std::size_t>; // ключ, номер куска
+    std::priority_queue<Head> heads;
+    for (const Run *run = first; run != last; ++run) {
+        readers.emplace_back(in, *run, bufferKeys);
+        uint32_t key;
+        if (readers.back().next(key)) {
+            heads.emplace(key, readers.size() - 1);
+        }
+    }
+    std::vector<uint32_t> keys;
+    keys.reserve(bufferKeys);
+    while (!heads.empty()) {
+        auto [key, run] = heads.top();
+        heads.pop();
+        keys.push_back(key);
+        if (keys.size() == bufferKeys) {
+            writeKeys(out, keys);
+            keys.clear();
+        }
+        if (readers[run].next(key)) {
+            heads.emplace(key, run);
+        }
+    }
+    writeKeys(out, keys);
+}
+
+} // namespace
+
+SortedFile::~SortedFile() {
+    if (file) {
+        std::fclose(file);
+    }
+}
+
+std::string DefaultTempDir() {
+    const char *dir = std::getenv("TMPDIR");
+    return dir && *dir ? dir : "/tmp";
+}
+
+std::FILE *CreateTempFile(const std::string &dir) {
+    std::string path = dir + "/ip_filter_XXXXXX";
+    int fd = ::mkstemp(path.data());
+    if (fd < 0) {
+        throw std::runtime_error("Failed to create temporary file in " + dir);
+    }
+    // имя сразу удаляем, файл живет, пока открыт
+    ::unlink(path.c_str());
+    std::FILE *file = ::fdopen(fd, "w+b");
+    if (!file) {
+        ::close(fd);
+        throw std::runtime_error("Failed to open temporary file.");
+    }
+    return file;
+}
+
+SortedFile ExternalSortIPAddressesRevers(IStream &io, std::size_t memoryBudget, const std::string &tempDir) {
+    const std::size_t chunkSize = std::max(MinChunkSize, memoryBudget / BytesPerAddress);
+
+    // 1. отсортированные куски подряд в одном временном файле
+    TempFile runsFile = createTempFile(tempDir);
+    std::vector<Run> runs;
+    std::size_t total = 0;
+    {
+        std::vector<IPAddress> chunk(chunkSize);
+        std::vector<uint32_t> keys;
+        for (;;) {
+            std::size_t n = 0;
+            while (n < chunkSize) {
+                const std::size_t read = io.readBatch(chunk.data() + n, std::min(ReadBatchSize, chunkSize - n));
+                if (read == 0) {
+                    break;
+                }
+                n += read;
+            }
+            if (n == 0) {
+                break;
+            }
+            keys.resize(n);
+            std::transform(chunk.begin(), chunk.begin() + static_cast<std::ptrdiff_t>(n), keys.begin(),
+                           [](const IPAddress &ip) { return ip.key(); });
+            RadixSortDescending(keys);
+            writeKeys(runsFile.get(), keys);
+            runs.push_back(Run{total, n});
+            total += n;
+            if (n < chunkSize) {
+                break;
+            }
+        }
+    }
+
+    // 2. слияние в несколько проходов: за проход сливается не больше fanIn
+    // кусков, fanIn буферов чтения и буфер записи укладываются в бюджет
+    const std::size_t fanIn = std::clamp(memoryBudget / sizeof(uint32_t) / MinReadBuffer, std::size_t{3}, MaxFanIn + 1) - 1;
+    const std::size_t bufferKeys = std::max(MinReadBuffer, memoryBudget / sizeof(uint32_t) / (fanIn + 1));
+    while (runs.size() > 1) {
+        if (std::fflush(runsFile.get()) != 0) {
+            throw std::runtime_error("Failed to write temporary file.");
+        }
+        TempFile merged = createTempFile(tempDir);
+        std::vector<Run> mergedRuns;
+        std::size_t offset = 0;
+        for (std::size_t i = 0; i < runs.size(); i += fanIn) {
+            const std::size_t last = std::min(runs.size(), i + fanIn);
+            std::size_t count = 0;
+            for (std::size_t k = i; k < last; ++k) {
+                count += runs[k].count;
+            }
+            mergeRuns(runsFile.get(), runs.data() + i, runs.data() + last, merged.get(), bufferKeys);
+            mergedRuns.push_back(Run{offset, count});
+            offset += count;
+        }
+        runsFile = std::move(merged);
+        runs = std::move(mergedRuns);
+    }
+    return SortedFile(runsFile.release(), total);
+}
+
+std::vector<IPAddress> TopIPAddresses(IStream &io, std::size_t k) {
+    // min-куча из k наибольших ключей: вершина - кандидат на вытеснение
+    std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> top;
+    std::vector<IPAddress> batch(ReadBatchSize);
+    if (k > 0) {
+        for (std::size_t n; (n = io.readBatch(batch.data(), batch.size())) > 0;) {
+            for (std::size_t i = 0; i < n; ++i) {
+                const uint32_t key = batch[i].key();
+                if (top.size() < k) {
+                    top.push(key);
+                } else if (key > top.top()) {
+                    top.pop();
+                    top.push(key);
+                }
+            }
+        }
+    }
+    std::vector<IPAddress> result(top.size());
+    for (auto it = result.rbegin(); it != result.rend(); ++it) {
+        *it = IPAddress::fromKey(top.top());
+        top.pop();
+    }
+    return result;
+}
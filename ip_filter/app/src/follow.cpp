@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "follow.h"
+#include "mapped_stream.h"
+
+namespace {
+
+// слияние двух векторов по убыванию
+std::vector<IPAddress> mergeDescending(const std::vector<IPAddress> &lhs, const std::vector<IPAddress> &rhs) {
+    std::vector<IPAddress> merged;
+    merged.reserve(lhs.size() + rhs.size());
+    std::merge(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), std::back_inserter(merged),
+               [](const IPAddress &a, const IPAddress &b) { return a.key() > b.key(); });
+    return merged;
+}
+
+} // namespace
+
+LogFollower::LogFollower(const std::string &filePath) : path(filePath) {
+    open();
+}
+
+LogFollower::~LogFollower() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+void LogFollower::open() {
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open file.");
+    }
+    offset = 0;
+    pending.clear();
+}
+
+std::size_t LogFollower::readAppended(std::vector<IPAddress> &out) {
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        throw std::runtime_error("Failed to stat file.");
+    }
+    // файл усечен - читаем заново с начала
+    if (static_cast<std::size_t>(st.st_size) < offset) {
+        offset = 0;
+        pending.clear();
+    }
+
+    std::size_t added = 0;
+    std::vector<char> chunk(ChunkSize);
+    IPAddress ip;
+    for (;;) {
+        const ssize_t n = ::pread(fd, chunk.data(), chunk.size(), static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Failed to read file.");
+        }
+        if (n == 0) {
+            break;
+        }
+        offset += static_cast<std::size_t>(n);
+        counters.bytes += static_cast<std::size_t>(n);
+
+        const char *first = chunk.data();
+        const char *last = first + n;
+        while (first != last) {
+            const char *eol = static_cast<const char *>(std::memchr(first, '\n', static_cast<std::size_t>(last - first)));
+            if (!eol) {
+                pending.append(first, last);
+                break;
+            }
+            // строка, начатая в прошлом куске, собирается в pending
+            bool ok;
+            if (pending.empty()) {
+                ok = ParseIPLine(first, eol, ip);
+            } else {
+                pending.append(first, eol);
+                ok = ParseIPLine(pending.data(), pending.data() + pending.size(), ip);
+                pending.clear();
+            }
+            ++counters.lines;
+            if (ok) {
+                out.push_back(ip);
+                ++added;
+            } else {
+                ++counters.rejected;
+            }
+            first = eol + 1;
+        }
+    }
+    return added;
+}
+
+std::size_t LogFollower::flushPending(std::vector<IPAddress> &out) {
+    if (pending.empty()) {
+        return 0;
+    }
+    IPAddress ip;
+    const bool ok = ParseIPLine(pending.data(), pending.data() + pending.size(), ip);
+    pending.clear();
+    ++counters.lines;
+    if (!ok) {
+        ++counters.rejected;
+        return 0;
+    }
+    out.push_back(ip);
+    return 1;
+}
+
+std::size_t LogFollower::poll(std::vector<IPAddress> &out) {
+    std::size_t added = readAppended(out);
+
+    // ротация: по пути лежит другой файл - старый дочитан, переходим на новый
+    struct stat current;
+    struct stat opened;
+    if (::stat(path.c_str(), &current) == 0 && ::fstat(fd, &opened) == 0 &&
+        (current.st_ino != opened.st_ino || current.st_dev != opened.st_dev)) {
+        // в старый файл больше не пишут - недописанная строка уже не продолжится
+        added += flushPending(out);
+        ::close(fd);
+        fd = -1;
+        open();
+        added += readAppended(out);
+    }
+    return added;
+}
+
+void SortedRuns::add(std::vector<IPAddress> run) {
+    if (run.empty()) {
+        return;
+    }
+    runs.push_back(std::move(run));
+    while (runs.size() >= 2 && runs[runs.size() - 2].size() <= 2 * runs.back().size()) {
+        auto merge = mergeDescending(runs[runs.size() - 2], runs.back());
+        runs.pop_back();
+        runs.back() = std::move(merge);
+    }
+}
+
+const std::vector<IPAddress> &SortedRuns::sorted() {
+    // прогоны сливаются от меньших к большим, накопленное - последним
+    while (runs.size() >= 2) {
+        auto merge = mergeDescending(runs[runs.size() - 2], runs.back());
+        runs.pop_back();
+        runs.back() = std::move(merge);
+    }
+    if (!runs.empty()) {
+        merged = merged.empty() ? std::move(runs.back()) : mergeDescending(merged, runs.back());
+        runs.clear();
+    }
+    return merged;
+}
+
+IncrementalResults::IncrementalResults(CompiledRuleSet rules) : rules(std::move(rules)), matches(this->rules.size()) {}
+
+void IncrementalResults::add(const std::vector<IPAddress> &batch) {
+    if (batch.empty()) {
+        return;
+    }
+    auto sortedBatch = SortIPAddressesRevers(batch, SortEngine::Radix);
+
+    // правила проверяются только на новой порции
+    auto batchMatches = rules.evaluate(sortedBatch);
+    for (std::size_t id = 0; id < matches.size(); ++id) {
+        matches[id].add(std::move(batchMatches[id]));
+    }
+    all.add(std::move(sortedBatch));
+}
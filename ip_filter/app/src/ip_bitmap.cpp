@@ -0,0 +1,301 @@
+#include <algorithm>
+#include <iterator>
+#include "ip_bitmap.h"
+
+namespace {
+
+inline void setBit(std::vector<uint64_t> &bits, uint16_t low) {
+    bits[low >> 6] |= uint64_t{1} << (low & 63);
+}
+
+inline bool testBit(const std::vector<uint64_t> &bits, uint16_t low) {
+    return (bits[low >> 6] >> (low & 63)) & 1;
+}
+
+uint32_t countBits(const std::vector<uint64_t> &bits) {
+    uint32_t count = 0;
+    for (uint64_t word : bits) {
+        count += static_cast<uint32_t>(__builtin_popcountll(word));
+    }
+    return count;
+}
+
+} // namespace
+
+bool IPBitmap::Container::contains(uint16_t low) const {
+    if (isBitmap()) {
+        return testBit(bits, low);
+    }
+    return std::binary_search(array.begin(), array.end(), low);
+}
+
+void IPBitmap::Container::normalize() {
+    if (isBitmap()) {
+        cardinality = countBits(bits);
+        if (cardinality <= ArrayLimit) {
+            array.clear();
+            array.reserve(cardinality);
+            for (std::size_t w = 0; w < BitmapWords; ++w) {
+                for (uint64_t word = bits[w]; word; word &= word - 1) {
+                    array.push_back(static_cast<uint16_t>(w * 64 + static_cast<unsigned>(__builtin_ctzll(word))));
+                }
+            }
+            std::vector<uint64_t>().swap(bits);
+        }
+    } else {
+        cardinality = static_cast<uint32_t>(array.size());
+        if (cardinality > ArrayLimit) {
+            bits.assign(BitmapWords, 0);
+            for (uint16_t low : array) {
+                setBit(bits, low);
+            }
+            std::vector<uint16_t>().swap(array);
+        }
+    }
+}
+
+IPBitmap::Container IPBitmap::makeBitmap(uint16_t high) {
+    Container c;
+    c.high = high;
+    c.bits.assign(BitmapWords, 0);
+    return c;
+}
+
+const IPBitmap::Container *IPBitmap::findContainer(uint16_t high) const {
+    if (blockIndex.empty() || blockIndex[high] == NoContainer) {
+        return nullptr;
+    }
+    return &containers[blockIndex[high]];
+}
+
+void IPBitmap::buildIndex() {
+    if (containers.empty()) {
+        std::vector<uint32_t>().swap(blockIndex);
+        return;
+    }
+    blockIndex.assign(1 << 16, NoContainer);
+    for (std::size_t i = 0; i < containers.size(); ++i) {
+        blockIndex[containers[i].high] = static_cast<uint32_t>(i);
+    }
+}
+
+IPBitmap::IPBitmap(const std::vector<IPAddress> &ips) {
+    std::vector<uint32_t> keys(ips.size());
+    std::transform(ips.begin(), ips.end(), keys.begin(), [](const IPAddress &ip) { return ip.key(); });
+    RadixSortDescending(keys);
+
+    // ключи по убыванию, блоки собираем с конца
+    for (auto key = keys.rbegin(); key != keys.rend(); ++key) {
+        const auto high = static_cast<uint16_t>(*key >> 16);
+        const auto low = static_cast<uint16_t>(*key);
+        if (containers.empty() || containers.back().high != high) {
+            if (!containers.empty()) {
+                containers.back().normalize();
+            }
+            containers.emplace_back();
+            containers.back().high = high;
+        }
+        auto &array = containers.back().array;
+        if (array.empty() || array.back() != low) {
+            array.push_back(low);
+        }
+    }
+    if (!containers.empty()) {
+        containers.back().normalize();
+    }
+    buildIndex();
+}
+
+bool IPBitmap::contains(const IPAddress &ip) const {
+    const uint32_t key = ip.key();
+    const Container *c = findContainer(static_cast<uint16_t>(key >> 16));
+    return c && c->contains(static_cast<uint16_t>(key));
+}
+
+void IPBitmap::add(const IPAddress &ip) {
+    const uint32_t key = ip.key();
+    const auto high = static_cast<uint16_t>(key >> 16);
+    const auto low = static_cast<uint16_t>(key);
+    auto it = std::lower_bound(containers.begin(), containers.end(), high,
+                               [](const Container &c, uint16_t value) { return c.high < value; });
+    if (it == containers.end() || it->high != high) {
+        it = containers.emplace(it);
+        it->high = high;
+        // номера следующих блоков сдвинулись на один
+        if (blockIndex.empty()) {
+            blockIndex.assign(1 << 16, NoContainer);
+        }
+        for (auto next = it; next != containers.end(); ++next) {
+            blockIndex[next->high] = static_cast<uint32_t>(next - containers.begin());
+        }
+    }
+    if (it->isBitmap()) {
+        if (!testBit(it->bits, low)) {
+            setBit(it->bits, low);
+            ++it->cardinality;
+        }
+        return;
+    }
+    auto pos = std::lower_bound(it->array.begin(), it->array.end(), low);
+    if (pos == it->array.end() || *pos != low) {
+        it->array.insert(pos, low);
+        it->normalize();
+    }
+}
+
+std::size_t IPBitmap::size() const {
+    std::size_t count = 0;
+    for (const auto &c : containers) {
+        count += c.cardinality;
+    }
+    return count;
+}
+
+std::vector<IPAddress> IPBitmap::toVector() const {
+    std::vector<IPAddress> ips;
+    ips.reserve(size());
+    forEach([&](const IPAddress &ip) { ips.push_back(ip); });
+    return ips;
+}
+
+IPBitmap::Container IPBitmap::unite(const Container &lhs, const Container &rhs) {
+    if (!lhs.isBitmap() && !rhs.isBitmap() && lhs.cardinality + rhs.cardinality <= ArrayLimit) {
+        Container c;
+        c.high = lhs.high;
+        std::set_union(lhs.array.begin(), lhs.array.end(), rhs.array.begin(), rhs.array.end(), std::back_inserter(c.array));
+        c.normalize();
+        return c;
+    }
+    Container c = makeBitmap(lhs.high);
+    for (const Container *side : {&lhs, &rhs}) {
+        if (side->isBitmap()) {
+            for (std::size_t w = 0; w < BitmapWords; ++w) {
+                c.bits[w] |= side->bits[w];
+            }
+        } else {
+            for (uint16_t low : side->array) {
+                setBit(c.bits, low);
+            }
+        }
+    }
+    c.normalize();
+    return c;
+}
+
+IPBitmap::Container IPBitmap::intersect(const Container &lhs, const Container &rhs) {
+    Container c;
+    c.high = lhs.high;
+    if (lhs.isBitmap() && rhs.isBitmap()) {
+        c.bits.resize(BitmapWords);
+        for (std::size_t w = 0; w < BitmapWords; ++w) {
+            c.bits[w] = lhs.bits[w] & rhs.bits[w];
+        }
+    } else if (!lhs.isBitmap() && !rhs.isBitmap()) {
+        c.array.reserve(std::min(lhs.array.size(), rhs.array.size()));
+        std::set_intersection(lhs.array.begin(), lhs.array.end(), rhs.array.begin(), rhs.array.end(), std::back_inserter(c.array));
+    } else {
+        // массив проверяется по битовой карте
+        const Container &array = lhs.isBitmap() ? rhs : lhs;
+        const Container &bitmap = lhs.isBitmap() ? lhs : rhs;
+        std::copy_if(array.array.begin(), array.array.end(), std::back_inserter(c.array),
+                     [&](uint16_t low) { return testBit(bitmap.bits, low); });
+    }
+    c.normalize();
+    return c;
+}
+
+IPBitmap::Container IPBitmap::subtract(const Container &lhs, const Container &rhs) {
+    Container c;
+    c.high = lhs.high;
+    if (lhs.isBitmap()) {
+        c.bits = lhs.bits;
+        if (rhs.isBitmap()) {
+            for (std::size_t w = 0; w < BitmapWords; ++w) {
+                c.bits[w] &= ~rhs.bits[w];
+            }
+        } else {
+            for (uint16_t low : rhs.array) {
+                c.bits[low >> 6] &= ~(uint64_t{1} << (low & 63));
+            }
+        }
+    } else if (rhs.isBitmap()) {
+        std::copy_if(lhs.array.begin(), lhs.array.end(), std::back_inserter(c.array),
+                     [&](uint16_t low) { return !testBit(rhs.bits, low); });
+    } else {
+        std::set_difference(lhs.array.begin(), lhs.array.end(), rhs.array.begin(), rhs.array.end(), std::back_inserter(c.array));
+    }
+    c.normalize();
+    return c;
+}
+
+IPBitmap operator|(const IPBitmap &lhs, const IPBitmap &rhs) {
+    IPBitmap result;
+    auto l = lhs.containers.begin();
+    auto r = rhs.containers.begin();
+    while (l != lhs.containers.end() || r != rhs.containers.end()) {
+        if (r == rhs.containers.end() || (l != lhs.containers.end() && l->high < r->high)) {
+            result.containers.push_back(*l++);
+        } else if (l == lhs.containers.end() || r->high < l->high) {
+            result.containers.push_back(*r++);
+        } else {
+            result.containers.push_back(IPBitmap::unite(*l++, *r++));
+        }
+    }
+    result.buildIndex();
+    return result;
+}
+
+IPBitmap operator&(const IPBitmap &lhs, const IPBitmap &rhs) {
+    IPBitmap result;
+    auto l = lhs.containers.begin();
+    auto r = rhs.containers.begin();
+    while (l != lhs.containers.end() && r != rhs.containers.end()) {
+        if (l->high < r->high) {
+            ++l;
+        } else if (r->high < l->high) {
+            ++r;
+        } else {
+            auto c = IPBitmap::intersect(*l++, *r++);
+            if (c.cardinality > 0) {
+                result.containers.push_back(std::move(c));
+            }
+        }
+    }
+    result.buildIndex();
+    return result;
+}
+
+IPBitmap operator-(const IPBitmap &lhs, const IPBitmap &rhs) {
+    IPBitmap result;
+    auto r = rhs.containers.begin();
+    for (const auto &l : lhs.containers) {
+        while (r != rhs.containers.end() && r->high < l.high) {
+            ++r;
+        }
+        if (r == rhs.containers.end() || r->high != l.high) {
+            result.containers.push_back(l);
+            continue;
+        }
+        auto c = IPBitmap::subtract(l, *r);
+        if (c.cardinality > 0) {
+            result.containers.push_back(std::move(c));
+        }
+    }
+    result.buildIndex();
+    return result;
+}
+
+bool IPBitmap::operator==(const IPBitmap &rhs) const {
+    // представление блока однозначно определяется его содержимым, таблица блоков - списком блоков
+    if (containers.size() != rhs.containers.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < containers.size(); ++i) {
+        const auto &a = containers[i];
+        const auto &b = rhs.containers[i];
+        if (a.high != b.high || a.cardinality != b.cardinality || a.array != b.array || a.bits != b.bits) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,104 @@
+#include "ip_counter.h"
+
+namespace {
+
+constexpr std::size_t MinCapacity = 1 << 10;
+
+} // namespace
+
+IPCounter::IPCounter(std::size_t expectedUnique) {
+    // заполнение не больше половины
+    std::size_t capacity = MinCapacity;
+    unsigned bits = 10;
+    while (capacity < expectedUnique * 2) {
+        capacity <<= 1;
+        ++bits;
+    }
+    keys.assign(capacity, 0);
+    counts.assign(capacity, 0);
+    shift = 64 - bits;
+}
+
+void IPCounter::add(const IPAddress &ip, uint64_t count) {
+    if (count == 0) {
+        return;
+    }
+    const uint32_t key = ip.key();
+    const std::size_t mask = keys.size() - 1;
+    for (std::size_t i = slot(key);; i = (i + 1) & mask) {
+        if (counts[i] == 0) {
+            keys[i] = key;
+            counts[i] = count;
+            totalCount += count;
+            if (++uniqueCount * 2 > keys.size()) {
+                grow();
+            }
+            return;
+        }
+        if (keys[i] == key) {
+            counts[i] += count;
+            totalCount += count;
+            return;
+        }
+    }
+}
+
+uint64_t IPCounter::count(const IPAddress &ip) const {
+    const uint32_t key = ip.key();
+    const std::size_t mask = keys.size() - 1;
+    for (std::size_t i = slot(key); counts[i] != 0; i = (i + 1) & mask) {
+        if (keys[i] == key) {
+            return counts[i];
+        }
+    }
+    return 0;
+}
+
+void IPCounter::grow() {
+    std::vector<uint32_t> oldKeys = std::move(keys);
+    std::vector<uint64_t> oldCounts = std::move(counts);
+    keys.assign(oldKeys.size() * 2, 0);
+    counts.assign(oldCounts.size() * 2, 0);
+    --shift;
+    const std::size_t mask = keys.size() - 1;
+    for (std::size_t j = 0; j < oldKeys.size(); ++j) {
+        if (oldCounts[j] == 0) {
+            continue;
+        }
+        std::size_t i = slot(oldKeys[j]);
+        while (counts[i] != 0) {
+            i = (i + 1) & mask;
+        }
+        keys[i] = oldKeys[j];
+        counts[i] = oldCounts[j];
+    }
+}
+
+AggregatedIPs IPCounter::sortedRevers() const {
+    std::vector<uint32_t> unique;
+    unique.reserve(uniqueCount);
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        if (counts[i] != 0) {
+            unique.push_back(keys[i]);
+        }
+    }
+    RadixSortDescending(unique);
+
+    AggregatedIPs result;
+    result.ips.reserve(unique.size());
+    result.counts.reserve(unique.size());
+    for (uint32_t key : unique) {
+        result.ips.push_back(IPAddress::fromKey(key));
+        result.counts.push_back(count(result.ips.back()));
+    }
+    return result;
+}
+
+void CountIPAddresses(IPCounter &counter, IStream &io) {
+    std::vector<IPAddress> batch(ReadBatchSize);
+    for (std::size_t n; (n = io.readBatch(batch.data(), batch.size())) > 0;) {
+        for (std::size_t i = 0; i < n; ++i) {
+            counter.add(batch[i]);
+        }
+    }
+}
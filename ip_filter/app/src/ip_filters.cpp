@@ -9,38 +9,84 @@
 #include <limits>
 #include <fstream>
 #include "ip_filters.h"
+#include "parallel.h"
+#include "simd_filter.h"
+#include "ip_writer.h"
     
-// загрузка адресов в вектор
-void GetIPAddresses(std::vector<IPAddress> &ips, IStream& io)  {
-    IPAddress ip;
-    bool EndOfStream = false;
-    while (EndOfStream == false) {
-        auto result = io.read(ip);
-        if (result == ReadResult::EndOfStream) {
-            EndOfStream = true;
-            continue;
+namespace {
+
+// загрузка адресов в вектор пакетами, без виртуального вызова на каждый адрес
+template <typename Address>
+void getAddresses(std::vector<Address> &ips, BasicIStream<Address> &io) {
+    for (;;) {
+        // resize растет геометрически, так что емкость резервируется заранее
+        const std::size_t oldSize = ips.size();
+        ips.resize(oldSize + ReadBatchSize);
+        const std::size_t n = io.readBatch(ips.data() + oldSize, ReadBatchSize);
+        ips.resize(oldSize + n);
+        if (n == 0) {
+            break;
+        }
+    }
+}
+
+// LSD radix sort по убыванию: по проходу на каждый байт ключа
+template <typename Key>
+void radixSortDescending(std::vector<Key> &keys) {
+    constexpr int Passes = sizeof(Key);
+    // гистограммы всех байт за один проход
+    std::array<std::array<std::size_t, 256>, Passes> counts{};
+    for (Key key : keys) {
+        for (int pass = 0; pass < Passes; ++pass) {
+            ++counts[pass][255 - static_cast<std::size_t>((key >> (pass * 8)) & 0xFF)];
         }
-        else if (result == ReadResult::Failure) {
-           // std::cout << "Invalid IP address entered. Try again." << std::endl;
+    }
+
+    std::vector<Key> buffer(keys.size());
+    for (int pass = 0; pass < Passes; ++pass) {
+        auto &count = counts[pass];
+        // все ключи с одинаковым байтом - проход ничего не меняет
+        if (std::find(count.begin(), count.end(), keys.size()) != count.end()) {
             continue;
         }
-        ips.push_back(ip);
-       // std::cout << "IP address entered: " << ip << " count of ip:" <<   ips.size() << std::endl;
+        std::size_t offset = 0;
+        for (auto &c : count) {
+            std::size_t n = c;
+            c = offset;
+            offset += n;
+        }
+        const int shift = pass * 8;
+        for (Key key : keys) {
+            buffer[count[255 - static_cast<std::size_t>((key >> shift) & 0xFF)]++] = key;
+        }
+        keys.swap(buffer);
     }
 }
 
 //вернуть сортированый вектор
-std::vector<IPAddress> SortIPAddressesRevers(const std::vector<IPAddress>& ips) {
-    std::vector<IPAddress> sorted = ips;
-    std::sort(sorted.begin(), sorted.end(), [](const IPAddress& lhs, const IPAddress& rhs) {
+template <typename Address>
+std::vector<Address> sortAddressesRevers(const std::vector<Address> &ips, SortEngine engine) {
+    if (engine == SortEngine::Parallel) {
+        return SortIPAddressesReversParallel(ips, DefaultThreadCount());
+    }
+    if (engine == SortEngine::Radix) {
+        std::vector<typename Address::Key> keys(ips.size());
+        std::transform(ips.begin(), ips.end(), keys.begin(), [](const Address &ip) { return ip.key(); });
+        radixSortDescending(keys);
+        std::vector<Address> sorted(keys.size());
+        std::transform(keys.begin(), keys.end(), sorted.begin(), Address::fromKey);
+        return sorted;
+    }
+    std::vector<Address> sorted = ips;
+    std::sort(sorted.begin(), sorted.end(), [](const Address& lhs, const Address& rhs) {
         return rhs < lhs;
     });
     return sorted;
 }
 
-
-std::vector<IPAddress> FilterIPAddresses(const std::vector<IPAddress>& ips, uint8_t firstOctet, uint8_t secondOctet) {
-    std::vector<IPAddress> filtered;
+template <typename Address>
+std::vector<Address> filterAddresses(const std::vector<Address> &ips, uint8_t firstOctet, uint8_t secondOctet) {
+    std::vector<Address> filtered;
     for (const auto& ip : ips) {
         if (ip[0] == firstOctet && (secondOctet == 0 || ip[1] == secondOctet)) {
             filtered.push_back(ip);
@@ -49,18 +95,77 @@ std::vector<IPAddress> FilterIPAddresses(const std::vector<IPAddress>& ips, uint
     return filtered;
 }
 
-std::vector<IPAddress> FilterIPAddressesAnyOctet(const std::vector<IPAddress>& ips, uint8_t octet) {
-    std::vector<IPAddress> filtered;
+template <typename Address>
+std::vector<Address> filterAddressesAnyOctet(const std::vector<Address> &ips, uint8_t octet, FilterEngine engine) {
+    if (engine == FilterEngine::Simd) {
+        return FilterIPAddressesAnyOctetSimd(ips, octet, DetectSimdLevel());
+    }
+    std::vector<Address> filtered;
     for (const auto& ip : ips) {
-        if (ip[0] == octet || ip[1] == octet || ip[2] == octet || ip[3] == octet) {
+        const auto &bytes = ip.bytes();
+        if (std::find(bytes.begin(), bytes.end(), octet) != bytes.end()) {
             filtered.push_back(ip);
         }
     }
     return filtered;
 }
 
+} // namespace
+
+void GetIPAddresses(std::vector<IPAddress> &ips, IStream& io)  {
+    getAddresses(ips, io);
+}
+
+void RadixSortDescending(std::vector<uint32_t> &keys) {
+    radixSortDescending(keys);
+}
+
+std::vector<IPAddress> SortIPAddressesRevers(const std::vector<IPAddress>& ips, SortEngine engine) {
+    return sortAddressesRevers(ips, engine);
+}
+
+std::vector<IPAddress> FilterIPAddresses(const std::vector<IPAddress>& ips, uint8_t firstOctet, uint8_t secondOctet) {
+    return filterAddresses(ips, firstOctet, secondOctet);
+}
+
+std::vector<IPAddress> FilterIPAddressesAnyOctet(const std::vector<IPAddress>& ips, uint8_t octet, FilterEngine engine) {
+    return filterAddressesAnyOctet(ips, octet, engine);
+}
+
 void PrintIPAddresses(const std::vector<IPAddress>& ips) {
-    for (const auto& ip : ips) {
-        std::cout << ip << "\n";
-    }
+    PrintIPAddresses(IPRange(ips));
+}
+
+void PrintIPAddresses(IPRange ips) {
+    auto &writer = StdoutWriter();
+    writer.write(ips);
+    writer.flush();
+}
+
+// IPv6: тот же конвейер на 128-битных ключах
+
+void GetIPAddresses(std::vector<IPv6Address> &ips, IPv6Stream &io) {
+    getAddresses(ips, io);
+}
+
+void RadixSortDescending(std::vector<IPv6Address::Key> &keys) {
+    radixSortDescending(keys);
+}
+
+std::vector<IPv6Address> SortIPAddressesRevers(const std::vector<IPv6Address> &ips, SortEngine engine) {
+    return sortAddressesRevers(ips, engine);
+}
+
+std::vector<IPv6Address> FilterIPAddresses(const std::vector<IPv6Address> &ips, uint8_t firstOctet, uint8_t secondOctet) {
+    return filterAddresses(ips, firstOctet, secondOctet);
+}
+
+std::vector<IPv6Address> FilterIPAddressesAnyOctet(const std::vector<IPv6Address> &ips, uint8_t octet, FilterEngine engine) {
+    return filterAddressesAnyOctet(ips, octet, engine);
+}
+
+void PrintIPAddresses(const std::vector<IPv6Address> &ips) {
+    auto &writer = StdoutWriter();
+    writer.write(ips);
+    writer.flush();
 }
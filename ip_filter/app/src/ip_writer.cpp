@@ -0,0 +1,41 @@
+#include <array>
+#include "ip_writer.h"
+
+const OctetText *OctetTextTable() {
+    static const std::array<OctetText, 256> table = [] {
+        std::array<OctetText, 256> result{};
+        for (int value = 0; value < 256; ++value) {
+            OctetText &text = result[value];
+            int n = 0;
+            if (value >= 100) {
+                text.digits[n++] = static_cast<char>('0' + value / 100);
+            }
+            if (value >= 10) {
+                text.digits[n++] = static_cast<char>('0' + value / 10 % 10);
+            }
+            text.digits[n++] = static_cast<char>('0' + value % 10);
+            text.length = static_cast<uint8_t>(n);
+        }
+        return result;
+    }();
+    return table.data();
+}
+
+IPAddressWriter::IPAddressWriter(std::FILE *out, std::size_t bufferSize)
+    : out(out), buffer(std::max(bufferSize, MaxLineLength)) {}
+
+IPAddressWriter::~IPAddressWriter() {
+    flush();
+}
+
+void IPAddressWriter::flush() {
+    if (used > 0) {
+        std::fwrite(buffer.data(), 1, used, out);
+        used = 0;
+    }
+}
+
+IPAddressWriter &StdoutWriter() {
+    static IPAddressWriter writer(stdout);
+    return writer;
+}
@@ -0,0 +1,168 @@
+#include "ip_filters.h"
+
+namespace {
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// группа из 1-4 шестнадцатеричных цифр
+bool parseGroup(std::string_view text, uint16_t &group) {
+    if (text.empty() || text.size() > 4) {
+        return false;
+    }
+    unsigned value = 0;
+    for (char c : text) {
+        int digit = hexValue(c);
+        if (digit < 0) {
+            return false;
+        }
+        value = value * 16 + static_cast<unsigned>(digit);
+    }
+    group = static_cast<uint16_t>(value);
+    return true;
+}
+
+// IPv4 в последних 32 битах ("::ffff:1.2.3.4"), две группы
+bool parseIPv4Tail(std::string_view text, uint16_t *groups) {
+    uint8_t o[4];
+    for (int i = 0; i < 4; ++i) {
+        const std::size_t dot = i < 3 ? text.find('.') : text.size();
+        if (dot == std::string_view::npos || dot == 0 || dot > 3) {
+            return false;
+        }
+        unsigned value = 0;
+        for (char c : text.substr(0, dot)) {
+            if (c < '0' || c > '9') {
+                return false;
+            }
+            value = value * 10 + static_cast<unsigned>(c - '0');
+        }
+        if (value > 255) {
+            return false;
+        }
+        o[i] = static_cast<uint8_t>(value);
+        text.remove_prefix(i < 3 ? dot + 1 : dot);
+    }
+    groups[0] = static_cast<uint16_t>(o[0] << 8 | o[1]);
+    groups[1] = static_cast<uint16_t>(o[2] << 8 | o[3]);
+    return true;
+}
+
+// группы через ':' (без "::"), не больше maxGroups; возвращает их число или -1
+int parseGroups(std::string_view text, uint16_t *groups, int maxGroups) {
+    if (text.empty()) {
+        return 0;
+    }
+    int n = 0;
+    for (;;) {
+        const std::size_t colon = text.find(':');
+        const std::string_view part = text.substr(0, colon);
+        if (colon == std::string_view::npos && part.find('.') != std::string_view::npos) {
+            if (n + 2 > maxGroups || !parseIPv4Tail(part, groups + n)) {
+                return -1;
+            }
+            return n + 2;
+        }
+        if (n == maxGroups || !parseGroup(part, groups[n])) {
+            return -1;
+        }
+        ++n;
+        if (colon == std::string_view::npos) {
+            return n;
+        }
+        text.remove_prefix(colon + 1);
+    }
+}
+
+} // namespace
+
+bool ParseIPv6(std::string_view text, std::array<uint8_t, 16> &bytes) {
+    uint16_t head[8] = {};
+    uint16_t tail[8] = {};
+    int headCount = 0;
+    int tailCount = 0;
+
+    const std::size_t gap = text.find("::");
+    if (gap == std::string_view::npos) {
+        headCount = parseGroups(text, head, 8);
+        if (headCount != 8) {
+            return false;
+        }
+    } else {
+        // "::" - одна или больше нулевых групп, встречается не больше одного раза
+        const std::string_view after = text.substr(gap + 2);
+        if (after.find("::") != std::string_view::npos) {
+            return false;
+        }
+        headCount = parseGroups(text.substr(0, gap), head, 7);
+        if (headCount < 0) {
+            return false;
+        }
+        tailCount = parseGroups(after, tail, 7 - headCount);
+        if (tailCount < 0) {
+            return false;
+        }
+    }
+
+    uint16_t groups[8] = {};
+    std::copy(head, head + headCount, groups);
+    std::copy(tail, tail + tailCount, groups + 8 - tailCount);
+    for (int i = 0; i < 8; ++i) {
+        bytes[2 * i] = static_cast<uint8_t>(groups[i] >> 8);
+        bytes[2 * i + 1] = static_cast<uint8_t>(groups[i]);
+    }
+    return true;
+}
+
+char *FormatIPv6(const std::array<uint8_t, 16> &bytes, char *out) {
+    static const char digits[] = "0123456789abcdef";
+    uint16_t groups[8];
+    for (int i = 0; i < 8; ++i) {
+        groups[i] = static_cast<uint16_t>(bytes[2 * i] << 8 | bytes[2 * i + 1]);
+    }
+
+    // самая длинная (первая из равных) серия нулевых групп, не короче двух, сворачивается в "::"
+    int bestStart = -1;
+    int bestLength = 1;
+    for (int i = 0; i < 8;) {
+        if (groups[i] != 0) {
+            ++i;
+            continue;
+        }
+        int j = i;
+        while (j < 8 && groups[j] == 0) {
+            ++j;
+        }
+        if (j - i > bestLength) {
+            bestStart = i;
+            bestLength = j - i;
+        }
+        i = j;
+    }
+
+    for (int i = 0; i < 8; ++i) {
+        if (i == bestStart) {
+            *out++ = ':';
+            *out++ = ':';
+            i += bestLength - 1;
+            continue;
+        }
+        if (i > 0 && i != bestStart + bestLength) {
+            *out++ = ':';
+        }
+        // без ведущих нулей, строчные цифры
+        bool started = false;
+        for (int shift = 12; shift >= 0; shift -= 4) {
+            const unsigned digit = (groups[i] >> shift) & 0xF;
+            if (digit != 0 || started || shift == 0) {
+                *out++ = digits[digit];
+                started = true;
+            }
+        }
+    }
+    return out;
+}
@@ -0,0 +1,156 @@
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "mapped_stream.h"
+#include "parallel.h"
+
+namespace {
+
+// начало следующей строки после p (или end)
+const char *nextLine(const char *p, const char *end) {
+    const char *eol = static_cast<const char *>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)));
+    return eol ? eol + 1 : end;
+}
+
+// разбор всех строк [first, last) с добавлением адресов в out
+void parseLines(const char *first, const char *last, std::vector<IPAddress> &out, ReadStats &stats) {
+    IPAddress ip;
+    while (first != last) {
+        const char *eol = static_cast<const char *>(std::memchr(first, '\n', static_cast<std::size_t>(last - first)));
+        ++stats.lines;
+        if (ParseIPLine(first, eol ? eol : last, ip)) {
+            out.push_back(ip);
+        } else {
+            ++stats.rejected;
+        }
+        first = eol ? eol + 1 : last;
+    }
+}
+
+} // namespace
+
+bool ParseIPLine(const char *first, const char *last, IPAddress &ip) {
+    return ParseIPAddress(std::string_view(first, static_cast<std::size_t>(last - first)), ip);
+}
+
+bool IsRegularFile(const std::string &filePath) {
+    struct stat st;
+    return ::stat(filePath.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+MappedFile::MappedFile(const std::string &filePath, bool sequential) {
+    int fd = ::open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open file.");
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Failed to stat file.");
+    }
+    // у канала st_size равен 0, он выглядел бы пустым файлом
+    if (!S_ISREG(st.st_mode)) {
+        ::close(fd);
+        throw std::runtime_error("Not a regular file.");
+    }
+    length = static_cast<std::size_t>(st.st_size);
+    // пустой файл отобразить нельзя, он остается пустым диапазоном
+    if (length > 0) {
+        void *mapped = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Failed to map file.");
+        }
+        if (sequential) {
+            ::madvise(mapped, length, MADV_SEQUENTIAL);
+        }
+        first = static_cast<const char *>(mapped);
+    }
+    ::close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (first) {
+        ::munmap(const_cast<char *>(first), length);
+    }
+}
+
+ReadResult MappedFileStream::read(IPAddress &ip) {
+    const char *end = file.end();
+    if (pos == end) {
+        return ReadResult::EndOfStream;
+    }
+    const char *eol = static_cast<const char *>(std::memchr(pos, '\n', static_cast<std::size_t>(end - pos)));
+    const char *lineEnd = eol ? eol : end;
+    const bool ok = ParseIPLine(pos, lineEnd, ip);
+    const char *next = eol ? eol + 1 : end;
+    ++counters.lines;
+    counters.rejected += ok ? 0 : 1;
+    counters.bytes += static_cast<std::size_t>(next - pos);
+    pos = next;
+    return ok ? ReadResult::Success : ReadResult::Failure;
+}
+
+std::size_t MappedFileStream::readBatch(IPAddress *out, std::size_t count) {
+    const char *end = file.end();
+    const char *start = pos;
+    std::size_t n = 0;
+    while (n < count && pos != end) {
+        const char *eol = static_cast<const char *>(std::memchr(pos, '\n', static_cast<std::size_t>(end - pos)));
+        const char *lineEnd = eol ? eol : end;
+        ++counters.lines;
+        if (ParseIPLine(pos, lineEnd, out[n])) {
+            ++n;
+        } else {
+            ++counters.rejected;
+        }
+        pos = eol ? eol + 1 : end;
+    }
+    counters.bytes += static_cast<std::size_t>(pos - start);
+    return n;
+}
+
+void MappedFileStream::readAll(std::vector<IPAddress> &ips, unsigned threads) {
+    const char *end = file.end();
+    const std::size_t bytesLeft = static_cast<std::size_t>(end - pos);
+    // на совсем маленьких файлах потоки не окупаются
+    threads = static_cast<unsigned>(std::max<std::size_t>(1, std::min<std::size_t>(threads, bytesLeft / MinBytesPerThread)));
+
+    // границы кусков выровнены на начало строки
+    std::vector<const char *> bounds(threads + 1);
+    bounds[0] = pos;
+    bounds[threads] = end;
+    for (unsigned t = 1; t < threads; ++t) {
+        const char *nominal = pos + bytesLeft / threads * t;
+        bounds[t] = std::max(bounds[t - 1], nextLine(nominal, end));
+    }
+
+    // каждый поток разбирает свой кусок в свой вектор
+    std::vector<std::vector<IPAddress>> parts(threads);
+    std::vector<ReadStats> partStats(threads);
+    ParallelFor(threads, [&](unsigned t) {
+        // строка "a.b.c.d\t..." не короче 8 байт
+        parts[t].reserve(static_cast<std::size_t>(bounds[t + 1] - bounds[t]) / 8);
+        parseLines(bounds[t], bounds[t + 1], parts[t], partStats[t]);
+    });
+    pos = end;
+    for (const auto &part : partStats) {
+        counters.lines += part.lines;
+        counters.rejected += part.rejected;
+    }
+    counters.bytes += bytesLeft;
+
+    // склейка в исходном порядке кусков
+    std::vector<std::size_t> offsets(threads + 1, ips.size());
+    for (unsigned t = 0; t < threads; ++t) {
+        offsets[t + 1] = offsets[t] + parts[t].size();
+    }
+    ips.resize(offsets[threads]);
+    ParallelFor(threads, [&](unsigned t) {
+        std::copy(parts[t].begin(), parts[t].end(), ips.begin() + static_cast<std::ptrdiff_t>(offsets[t]));
+        std::vector<IPAddress>().swap(parts[t]);
+    });
+}
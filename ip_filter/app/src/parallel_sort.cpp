@@ -0,0 +1,76 @@
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include "ip_filters.h"
+#include "parallel.h"
+
+namespace {
+
+constexpr std::size_t BucketCount = 256;
+using Histogram = std::array<std::size_t, BucketCount>;
+
+// номер корзины: по первому октету, в обратном порядке
+template <typename Address>
+inline std::size_t bucketOf(const Address &ip) {
+    return BucketCount - 1 - ip[0];
+}
+
+template <typename Address>
+std::vector<Address> sortReversParallel(const std::vector<Address> &ips, unsigned threads) {
+    threads = std::max(1u, threads);
+    const std::size_t size = ips.size();
+    const std::size_t chunk = (size + threads - 1) / threads;
+    auto chunkBegin = [&](unsigned t) { return std::min(size, t * chunk); };
+
+    // 1. гистограмма первых октетов по кускам входа
+    std::vector<Histogram> counts(threads);
+    ParallelFor(threads, [&](unsigned t) {
+        Histogram &count = counts[t];
+        count.fill(0);
+        for (std::size_t i = chunkBegin(t), end = chunkBegin(t + 1); i < end; ++i) {
+            ++count[bucketOf(ips[i])];
+        }
+    });
+
+    // смещения: корзины подряд, внутри корзины - куски потоков по порядку
+    std::array<std::size_t, BucketCount + 1> bucketStart{};
+    std::size_t offset = 0;
+    for (std::size_t b = 0; b < BucketCount; ++b) {
+        bucketStart[b] = offset;
+        for (unsigned t = 0; t < threads; ++t) {
+            std::size_t n = counts[t][b];
+            counts[t][b] = offset;
+            offset += n;
+        }
+    }
+    bucketStart[BucketCount] = offset;
+
+    // 2. раскладка по корзинам прямо в результат, без копии входа
+    std::vector<Address> sorted(size);
+    ParallelFor(threads, [&](unsigned t) {
+        Histogram &position = counts[t];
+        for (std::size_t i = chunkBegin(t), end = chunkBegin(t + 1); i < end; ++i) {
+            sorted[position[bucketOf(ips[i])]++] = ips[i];
+        }
+    });
+
+    // 3. сортировка корзин: потоки разбирают корзины по одной, пока они не кончатся
+    std::atomic<std::size_t> nextBucket{0};
+    ParallelFor(threads, [&](unsigned) {
+        for (std::size_t b; (b = nextBucket.fetch_add(1, std::memory_order_relaxed)) < BucketCount;) {
+            std::sort(sorted.begin() + bucketStart[b], sorted.begin() + bucketStart[b + 1],
+                      [](const Address &lhs, const Address &rhs) { return lhs.key() > rhs.key(); });
+        }
+    });
+    return sorted;
+}
+
+} // namespace
+
+std::vector<IPAddress> SortIPAddressesReversParallel(const std::vector<IPAddress> &ips, unsigned threads) {
+    return sortReversParallel(ips, threads);
+}
+
+std::vector<IPv6Address> SortIPAddressesReversParallel(const std::vector<IPv6Address> &ips, unsigned threads) {
+    return sortReversParallel(ips, threads);
+}
@@ -0,0 +1,24 @@
+#include <sys/resource.h>
+#include "pipeline_stats.h"
+
+std::size_t PeakRSSBytes() {
+    struct rusage usage;
+    if (::getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    // в Linux ru_maxrss в килобайтах
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+}
+
+void PipelineStats::report(std::FILE *out, const std::string &mode, const ReadStats &read) const {
+    // имена режима и стадий - константы из main, экранирование не нужно
+    std::fprintf(out, "{\"mode\":\"%s\",\"stages\":{", mode.c_str());
+    for (std::size_t i = 0; i < stages.size(); ++i) {
+        std::fprintf(out, "%s\"%s\":%.6f", i > 0 ? "," : "", stages[i].first.c_str(), stages[i].second);
+    }
+    const double total = std::chrono::duration<double>(Clock::now() - started).count();
+    std::fprintf(out, "},\"total_seconds\":%.6f,\"lines\":{\"read\":%zu,\"accepted\":%zu,\"rejected\":%zu},"
+                      "\"bytes\":%zu,\"peak_rss_bytes\":%zu}\n",
+                 total, read.lines, read.accepted(), read.rejected, read.bytes, PeakRSSBytes());
+    std::fflush(out);
+}
@@ -0,0 +1,10 @@
+#include "prefix_index.h"
+
+PrefixIndex::PrefixIndex(IPRange sorted) : data(sorted.begin()), storage(TableSize + 1, 0) {
+    for (const auto &ip : sorted) {
+        ++storage[TableSize - 1 - (ip.key() >> 16) + 1];
+    }
+    for (std::size_t k = 1; k <= TableSize; ++k) {
+        storage[k] += storage[k - 1];
+    }
+}
@@ -0,0 +1,118 @@
+#include <charconv>
+#include <stdexcept>
+#include <string>
+#include "range_query.h"
+#include "mapped_stream.h"
+
+namespace {
+
+// ровно четыре октета через точку, вся строка - адрес: "1.2.3.4.5" не обрезается до 1.2.3.4
+IPAddress parseAddress(std::string_view text) {
+    uint8_t octets[4];
+    const char *first = text.data();
+    const char *last = text.data() + text.size();
+    for (int i = 0; i < 4; ++i) {
+        if (i > 0) {
+            if (first == last || *first != '.') {
+                throw std::invalid_argument("Invalid IP address: " + std::string(text));
+            }
+            ++first;
+        }
+        unsigned value = 0;
+        const auto [end, ec] = std::from_chars(first, last, value);
+        if (ec != std::errc() || end - first > 3 || value > 255) {
+            throw std::invalid_argument("Invalid IP address: " + std::string(text));
+        }
+        octets[i] = static_cast<uint8_t>(value);
+        first = end;
+    }
+    if (first != last) {
+        throw std::invalid_argument("Invalid IP address: " + std::string(text));
+    }
+    return IPAddress(octets[0], octets[1], octets[2], octets[3]);
+}
+
+} // namespace
+
+AddressRange AddressRange::cidr(const IPAddress &base, unsigned prefixLength) {
+    if (prefixLength > 32) {
+        throw std::invalid_argument("Invalid CIDR prefix length: " + std::to_string(prefixLength));
+    }
+    const uint32_t mask = prefixLength == 0 ? 0 : ~uint32_t{0} << (32 - prefixLength);
+    const uint32_t low = base.key() & mask;
+    return AddressRange{low, low | ~mask};
+}
+
+AddressRange ParseAddressRange(std::string_view text) {
+    if (auto slash = text.find('/'); slash != std::string_view::npos) {
+        std::string_view length = text.substr(slash + 1);
+        if (length.empty() || length.size() > 2 || length.find_first_not_of("0123456789") != std::string_view::npos) {
+            throw std::invalid_argument("Invalid CIDR: " + std::string(text));
+        }
+        return AddressRange::cidr(parseAddress(text.substr(0, slash)), static_cast<unsigned>(std::stoi(std::string(length))));
+    }
+    if (auto dash = text.find('-'); dash != std::string_view::npos) {
+        const uint32_t low = parseAddress(text.substr(0, dash)).key();
+        const uint32_t high = parseAddress(text.substr(dash + 1)).key();
+        if (low > high) {
+            throw std::invalid_argument("Invalid range: " + std::string(text));
+        }
+        return AddressRange{low, high};
+    }
+    const uint32_t key = parseAddress(text).key();
+    return AddressRange{key, key};
+}
+
+RangeQuery::RangeQuery(std::initializer_list<std::string_view> rules) {
+    for (auto rule : rules) {
+        add(rule);
+    }
+}
+
+RangeQuery &RangeQuery::add(const AddressRange &range) {
+    merged.push_back(range);
+    std::sort(merged.begin(), merged.end(), [](const AddressRange &lhs, const AddressRange &rhs) {
+        return lhs.high > rhs.high;
+    });
+    // склеиваем пересекающиеся и соседние диапазоны
+    std::vector<AddressRange> result;
+    for (const auto &r : merged) {
+        if (!result.empty() && uint64_t{r.high} + 1 >= result.back().low) {
+            result.back().low = std::min(result.back().low, r.low);
+        } else {
+            result.push_back(r);
+        }
+    }
+    merged.swap(result);
+    return *this;
+}
+
+bool RangeQuery::matches(const IPAddress &ip) const {
+    const uint32_t key = ip.key();
+    // первый диапазон, начинающийся не выше key
+    auto it = std::partition_point(merged.begin(), merged.end(), [key](const AddressRange &r) { return r.low > key; });
+    return it != merged.end() && key <= it->high;
+}
+
+std::vector<IPRange> RangeQuery::find(IPRange sorted) const {
+    std::vector<IPRange> result;
+    const IPAddress *from = sorted.begin();
+    for (const auto &r : merged) {
+        // диапазоны и адреса идут по убыванию, поиск продолжается с места предыдущего
+        const IPAddress *first = std::partition_point(from, sorted.end(), [&r](const IPAddress &ip) { return ip.key() > r.high; });
+        const IPAddress *last = std::partition_point(first, sorted.end(), [&r](const IPAddress &ip) { return ip.key() >= r.low; });
+        if (first != last) {
+            result.emplace_back(first, last);
+        }
+        from = last;
+    }
+    return result;
+}
+
+std::vector<IPAddress> RangeQuery::filter(IPRange sorted) const {
+    std::vector<IPAddress> filtered;
+    for (const auto &part : find(sorted)) {
+        filtered.insert(filtered.end(), part.begin(), part.end());
+    }
+    return filtered;
+}
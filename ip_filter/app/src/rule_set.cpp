@@ -0,0 +1,192 @@
+#include <charconv>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include "rule_set.h"
+
+namespace {
+
+uint8_t parseOctet(std::string_view text, std::string_view rule) {
+    unsigned value = 0;
+    const char *last = text.data() + text.size();
+    auto [ptr, ec] = std::from_chars(text.data(), last, value);
+    if (text.empty() || ec != std::errc() || ptr != last || value > 255) {
+        throw std::invalid_argument("Invalid filter rule: " + std::string(rule));
+    }
+    return static_cast<uint8_t>(value);
+}
+
+std::string_view trim(std::string_view text) {
+    const auto first = text.find_first_not_of(" \t\r");
+    if (first == std::string_view::npos) {
+        return {};
+    }
+    return text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+}
+
+// обход 16-битных блоков first.second, которые задевает правило:
+// func(блок, true) - правило совпадает со всеми адресами блока
+template <typename Func>
+void forEachBlock(const FilterRule &rule, Func func) {
+    if (rule.kind == RuleKind::AnyOctet) {
+        for (uint32_t block = 0; block < (1u << 16); ++block) {
+            if ((block >> 8) == rule.octet || (block & 0xFF) == rule.octet) {
+                func(block, true);
+            }
+        }
+        return;
+    }
+    for (uint32_t block = rule.range.low >> 16; block <= rule.range.high >> 16; ++block) {
+        const uint32_t low = block << 16;
+        func(block, rule.range.low <= low && rule.range.high >= (low | 0xFFFF));
+    }
+}
+
+} // namespace
+
+FilterRule FilterRule::prefix(uint8_t first) {
+    const uint32_t low = uint32_t{first} << 24;
+    return FilterRule{RuleKind::Prefix, AddressRange{low, low | 0xFFFFFF}, 0};
+}
+
+FilterRule FilterRule::prefix(uint8_t first, uint8_t second) {
+    const uint32_t low = uint32_t{first} << 24 | uint32_t{second} << 16;
+    return FilterRule{RuleKind::Prefix, AddressRange{low, low | 0xFFFF}, 0};
+}
+
+FilterRule FilterRule::anyOctet(uint8_t octet) {
+    return FilterRule{RuleKind::AnyOctet, AddressRange{}, octet};
+}
+
+FilterRule FilterRule::inRange(const AddressRange &range) {
+    return FilterRule{RuleKind::Range, range, 0};
+}
+
+bool FilterRule::matches(const IPAddress &ip) const {
+    if (kind == RuleKind::AnyOctet) {
+        return ip[0] == octet || ip[1] == octet || ip[2] == octet || ip[3] == octet;
+    }
+    return range.contains(ip);
+}
+
+FilterRule ParseFilterRule(std::string_view text) {
+    const std::string_view rule = trim(text);
+    const auto space = rule.find_first_of(" \t");
+    if (space == std::string_view::npos) {
+        throw std::invalid_argument("Invalid filter rule: " + std::string(text));
+    }
+    const std::string_view kind = rule.substr(0, space);
+    const std::string_view argument = trim(rule.substr(space));
+
+    if (kind == "prefix") {
+        const auto dot = argument.find('.');
+        if (dot == std::string_view::npos) {
+            return FilterRule::prefix(parseOctet(argument, text));
+        }
+        return FilterRule::prefix(parseOctet(argument.substr(0, dot), text), parseOctet(argument.substr(dot + 1), text));
+    }
+    if (kind == "any") {
+        return FilterRule::anyOctet(parseOctet(argument, text));
+    }
+    if (kind == "range") {
+        return FilterRule::inRange(ParseAddressRange(argument));
+    }
+    throw std::invalid_argument("Invalid filter rule: " + std::string(text));
+}
+
+RuleSet::RuleSet(std::initializer_list<std::string_view> rules) {
+    for (auto rule : rules) {
+        add(rule);
+    }
+}
+
+std::size_t RuleSet::add(const FilterRule &rule) {
+    // номер правила хранится в uint16_t
+    if (rules.size() > std::numeric_limits<uint16_t>::max()) {
+        throw std::length_error("Too many filter rules.");
+    }
+    rules.push_back(rule);
+    return rules.size() - 1;
+}
+
+CompiledRuleSet RuleSet::compile() const {
+    return CompiledRuleSet(rules);
+}
+
+RuleSet LoadRuleSet(const std::string &path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file.");
+    }
+    RuleSet rules;
+    std::string line;
+    while (std::getline(file, line)) {
+        const std::string_view rule = trim(line);
+        if (!rule.empty() && rule.front() != '#') {
+            rules.add(rule);
+        }
+    }
+    return rules;
+}
+
+CompiledRuleSet::CompiledRuleSet(std::vector<FilterRule> rules)
+    : rules(std::move(rules)), fullStart(BlockCount + 1, 0), partialStart(BlockCount + 1, 0) {
+    // списки по блокам в два прохода: подсчет длины, затем заполнение
+    for (const auto &rule : this->rules) {
+        forEachBlock(rule, [&](uint32_t block, bool full) {
+            ++(full ? fullStart : partialStart)[block + 1];
+        });
+    }
+    for (std::size_t k = 0; k < BlockCount; ++k) {
+        fullStart[k + 1] += fullStart[k];
+        partialStart[k + 1] += partialStart[k];
+    }
+    fullRules.resize(fullStart[BlockCount]);
+    partialRules.resize(partialStart[BlockCount]);
+
+    std::vector<uint32_t> fullPos(fullStart.begin(), fullStart.end() - 1);
+    std::vector<uint32_t> partialPos(partialStart.begin(), partialStart.end() - 1);
+    for (std::size_t id = 0; id < this->rules.size(); ++id) {
+        const auto &rule = this->rules[id];
+        forEachBlock(rule, [&](uint32_t block, bool full) {
+            if (full) {
+                fullRules[fullPos[block]++] = static_cast<uint16_t>(id);
+            } else {
+                partialRules[partialPos[block]++] = static_cast<uint16_t>(id);
+            }
+        });
+        if (rule.kind == RuleKind::AnyOctet) {
+            octetRules[rule.octet].push_back(static_cast<uint16_t>(id));
+        }
+    }
+}
+
+std::vector<std::vector<IPAddress>> CompiledRuleSet::evaluate(IPRange ips) const {
+    std::vector<std::vector<IPAddress>> matches(rules.size());
+    for (const IPAddress &ip : ips) {
+        const uint32_t block = ip.key() >> 16;
+        for (uint32_t i = fullStart[block]; i < fullStart[block + 1]; ++i) {
+            matches[fullRules[i]].push_back(ip);
+        }
+        for (uint32_t i = partialStart[block]; i < partialStart[block + 1]; ++i) {
+            const uint16_t id = partialRules[i];
+            if (rules[id].range.contains(ip)) {
+                matches[id].push_back(ip);
+            }
+        }
+        // any по первым двум октетам уже в таблице блоков, повтор октета не дает повтора адреса
+        const uint8_t o2 = ip[2];
+        const uint8_t o3 = ip[3];
+        if (o2 != ip[0] && o2 != ip[1]) {
+            for (uint16_t id : octetRules[o2]) {
+                matches[id].push_back(ip);
+            }
+        }
+        if (o3 != ip[0] && o3 != ip[1] && o3 != o2) {
+            for (uint16_t id : octetRules[o3]) {
+                matches[id].push_back(ip);
+            }
+        }
+    }
+    return matches;
+}
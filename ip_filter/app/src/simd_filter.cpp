@@ -0,0 +1,125 @@
+#include <algorithm>
+#include "simd_filter.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define IP_FILTER_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+// адреса в векторе лежат подряд без выравнивания, это и позволяет сравнивать их пачками
+static_assert(sizeof(IPAddress) == 4, "IPAddress must be packed into 4 bytes");
+static_assert(sizeof(IPv6Address) == 16, "IPv6Address must be packed into 16 bytes");
+
+namespace {
+
+// за итерацию обрабатывается блок из 64 байт
+constexpr std::size_t BlockBytes = 64;
+
+// mask: по Bytes бит на адрес, начиная с адреса base
+template <typename Address>
+inline void appendMatches(const std::vector<Address> &ips, std::size_t base, uint64_t mask,
+                          std::vector<Address> &filtered) {
+    constexpr std::size_t Bytes = Address::ByteCount;
+    constexpr uint64_t AddressBits = (uint64_t{1} << Bytes) - 1;
+    while (mask) {
+        const unsigned index = static_cast<unsigned>(__builtin_ctzll(mask)) / Bytes;
+        filtered.push_back(ips[base + index]);
+        mask &= ~(AddressBits << (index * Bytes));
+    }
+}
+
+template <typename Address>
+void filterScalar(const std::vector<Address> &ips, std::size_t from, uint8_t octet,
+                  std::vector<Address> &filtered) {
+    for (std::size_t i = from; i < ips.size(); ++i) {
+        const auto &bytes = ips[i].bytes();
+        if (std::find(bytes.begin(), bytes.end(), octet) != bytes.end()) {
+            filtered.push_back(ips[i]);
+        }
+    }
+}
+
+#ifdef IP_FILTER_X86_SIMD
+
+// 64 байта за итерацию: четыре 16-байтных сравнения
+template <typename Address>
+std::size_t filterSSE2(const std::vector<Address> &ips, uint8_t octet, std::vector<Address> &filtered) {
+    constexpr std::size_t PerBlock = BlockBytes / Address::ByteCount;
+    const char *data = reinterpret_cast<const char *>(ips.data());
+    const __m128i needle = _mm_set1_epi8(static_cast<char>(octet));
+    std::size_t i = 0;
+    for (; i + PerBlock <= ips.size(); i += PerBlock) {
+        const char *p = data + i * Address::ByteCount;
+        uint64_t mask = 0;
+        for (int part = 0; part < 4; ++part) {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + part * 16));
+            const auto bits = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+            mask |= uint64_t{bits} << (part * 16);
+        }
+        appendMatches(ips, i, mask, filtered);
+    }
+    return i;
+}
+
+// 64 байта за итерацию: два 32-байтных сравнения
+template <typename Address>
+__attribute__((target("avx2")))
+std::size_t filterAVX2(const std::vector<Address> &ips, uint8_t octet, std::vector<Address> &filtered) {
+    constexpr std::size_t PerBlock = BlockBytes / Address::ByteCount;
+    const char *data = reinterpret_cast<const char *>(ips.data());
+    const __m256i needle = _mm256_set1_epi8(static_cast<char>(octet));
+    std::size_t i = 0;
+    for (; i + PerBlock <= ips.size(); i += PerBlock) {
+        const char *p = data + i * Address::ByteCount;
+        const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 32));
+        const auto loBits = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, needle)));
+        const auto hiBits = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, needle)));
+        appendMatches(ips, i, (uint64_t{hiBits} << 32) | loBits, filtered);
+    }
+    return i;
+}
+
+#endif
+
+template <typename Address>
+std::vector<Address> filterAnyOctet(const std::vector<Address> &ips, uint8_t octet, SimdLevel level) {
+    level = std::min(level, DetectSimdLevel());
+    std::vector<Address> filtered;
+    std::size_t done = 0;
+#ifdef IP_FILTER_X86_SIMD
+    if (level == SimdLevel::AVX2) {
+        done = filterAVX2(ips, octet, filtered);
+    } else if (level == SimdLevel::SSE2) {
+        done = filterSSE2(ips, octet, filtered);
+    }
+#endif
+    // хвост, не кратный блоку
+    filterScalar(ips, done, octet, filtered);
+    return filtered;
+}
+
+} // namespace
+
+SimdLevel DetectSimdLevel() {
+#ifdef IP_FILTER_X86_SIMD
+    static const SimdLevel level = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return SimdLevel::AVX2;
+        }
+        return __builtin_cpu_supports("sse2") ? SimdLevel::SSE2 : SimdLevel::Scalar;
+    }();
+    return level;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+std::vector<IPAddress> FilterIPAddressesAnyOctetSimd(const std::vector<IPAddress> &ips, uint8_t octet, SimdLevel level) {
+    return filterAnyOctet(ips, octet, level);
+}
+
+std::vector<IPv6Address> FilterIPAddressesAnyOctetSimd(const std::vector<IPv6Address> &ips, uint8_t octet, SimdLevel level) {
+    return filterAnyOctet(ips, octet, level);
+}
@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include "snapshot.h"
+
+namespace {
+
+constexpr char SnapshotMagic[8] = {'I', 'P', 'F', 'S', 'N', 'A', 'P', '\0'};
+
+// снимок читается как массив IPAddress, раскладка должна совпадать с 4 байтами октетов
+static_assert(sizeof(IPAddress) == 4 && alignof(IPAddress) == 1, "IPAddress must be 4 plain bytes");
+static_assert(sizeof(SnapshotHeader) == 32, "SnapshotHeader must have no padding");
+
+std::size_t align8(std::size_t offset) {
+    return (offset + 7) & ~std::size_t{7};
+}
+
+} // namespace
+
+void WriteSnapshot(const std::string &path, IPRange sorted, bool withIndex) {
+    std::unique_ptr<std::FILE, int (*)(std::FILE *)> file(std::fopen(path.c_str(), "wb"), &std::fclose);
+    if (!file) {
+        throw std::runtime_error("Failed to create snapshot file.");
+    }
+
+    const std::size_t addressesEnd = sizeof(SnapshotHeader) + sorted.size() * sizeof(IPAddress);
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SnapshotMagic, sizeof(header.magic));
+    header.version = SnapshotVersion;
+    header.flags = withIndex ? SnapshotHasIndex : 0;
+    header.count = sorted.size();
+    header.indexOffset = withIndex ? align8(addressesEnd) : 0;
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, file.get()) == 1 &&
+              std::fwrite(sorted.begin(), sizeof(IPAddress), sorted.size(), file.get()) == sorted.size();
+    if (ok && withIndex) {
+        const char padding[8] = {};
+        PrefixIndex index(sorted);
+        ok = std::fwrite(padding, 1, header.indexOffset - addressesEnd, file.get()) == header.indexOffset - addressesEnd &&
+             std::fwrite(index.table(), sizeof(uint64_t), PrefixIndex::TableSize + 1, file.get()) == PrefixIndex::TableSize + 1;
+    }
+    if (!ok || std::fflush(file.get()) != 0) {
+        throw std::runtime_error("Failed to write snapshot file.");
+    }
+}
+
+Snapshot::Snapshot(const std::string &path) : file(path, false) {
+    if (file.size() < sizeof(SnapshotHeader)) {
+        throw std::runtime_error("Not a snapshot file.");
+    }
+    header = reinterpret_cast<const SnapshotHeader *>(file.data());
+    if (std::memcmp(header->magic, SnapshotMagic, sizeof(SnapshotMagic)) != 0) {
+        throw std::runtime_error("Not a snapshot file.");
+    }
+    if (header->version != SnapshotVersion) {
+        throw std::runtime_error("Unsupported snapshot version.");
+    }
+    const std::size_t addressesEnd = sizeof(SnapshotHeader) + header->count * sizeof(IPAddress);
+    const std::size_t indexSize = (PrefixIndex::TableSize + 1) * sizeof(uint64_t);
+    if (header->count > file.size() / sizeof(IPAddress) || addressesEnd > file.size() ||
+        (header->indexOffset != 0 && (header->indexOffset < addressesEnd || header->indexOffset % 8 != 0 ||
+                                      header->indexOffset > file.size() || indexSize > file.size() - header->indexOffset))) {
+        throw std::runtime_error("Corrupted snapshot file.");
+    }
+    // смещения таблицы индекса используются без проверок при поиске:
+    // начинаются с 0, не убывают и заканчиваются числом адресов
+    if (header->indexOffset != 0) {
+        const auto *table = reinterpret_cast<const uint64_t *>(file.data() + header->indexOffset);
+        if (table[0] != 0 || table[PrefixIndex::TableSize] != header->count ||
+            !std::is_sorted(table, table + PrefixIndex::TableSize + 1)) {
+            throw std::runtime_error("Corrupted snapshot file.");
+        }
+    }
+    const auto *first = reinterpret_cast<const IPAddress *>(file.data() + sizeof(SnapshotHeader));
+    ips = IPRange(first, first + header->count);
+}
+
+PrefixIndex Snapshot::index() const {
+    if (!hasIndex()) {
+        return PrefixIndex(ips);
+    }
+    return PrefixIndex(ips, reinterpret_cast<const uint64_t *>(file.data() + header->indexOffset));
+}
@@ -0,0 +1,486 @@
+#include <benchmark/benchmark.h>
+#include "ip_filters.h"
+#include "mapped_stream.h"
+#include "prefix_index.h"
+#include "ip_writer.h"
+#include "simd_filter.h"
+#include "rule_set.h"
+#include "ip_bitmap.h"
+#include <cstdio>
+#include <random>
+#include <string>
+
+// Бенчмарки конвейера ip_filter: чтение -> сортировка -> фильтры -> вывод.
+// Кроме флагов Google Benchmark понимает:
+//     --addresses=N                   число адресов во входном файле (по умолчанию 1000000)
+//     --octets=uniform|skewed         распределение октетов
+// Пример: ./bench/ip_filter_bench --addresses=5000000 --octets=skewed --benchmark_filter=Sort
+
+// Распределение октетов синтетического входа
+enum class OctetDistribution {
+    Uniform, // все октеты равновероятны
+    Skewed   // как в реальных логах: немного "горячих" подсетей, первые октеты повторяются
+};
+
+struct BenchConfig {
+    std::size_t addresses = 1'000'000;
+    OctetDistribution octets = OctetDistribution::Uniform;
+    std::string path = "ip_filter_bench.tsv";
+};
+
+BenchConfig &Config() {
+    static BenchConfig config;
+    return config;
+}
+
+// Синтетический входной файл в формате ip_filter.tsv
+void GenerateInputFile(const BenchConfig &config) {
+    std::FILE *out = std::fopen(config.path.c_str(), "w");
+    if (!out) {
+        throw std::runtime_error("Failed to create benchmark input.");
+    }
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> octet(0, 255);
+    std::uniform_int_distribution<int> field(0, 1000);
+    // skewed: первые два октета из геометрического распределения (около 16 подсетей на большую часть адресов)
+    std::geometric_distribution<int> hot(0.06);
+    auto prefixOctet = [&] {
+        return config.octets == OctetDistribution::Skewed ? std::min(hot(gen), 255) : octet(gen);
+    };
+    for (std::size_t i = 0; i < config.addresses; ++i) {
+        const int o1 = prefixOctet();
+        const int o2 = prefixOctet();
+        std::fprintf(out, "%d.%d.%d.%d\t%d\t%d\n", o1, o2, octet(gen), octet(gen), field(gen), field(gen));
+    }
+    std::fclose(out);
+}
+
+// Разобранный вход, общий для бенчмарков после стадии чтения
+const std::vector<IPAddress> &InputAddresses() {
+    static const std::vector<IPAddress> ips = [] {
+        std::vector<IPAddress> result;
+        MappedFileStream io(Config().path);
+        GetIPAddresses(result, io);
+        return result;
+    }();
+    return ips;
+}
+
+const std::vector<IPAddress> &SortedAddresses() {
+    static const std::vector<IPAddress> sorted = SortIPAddressesRevers(InputAddresses(), SortEngine::Radix);
+    return sorted;
+}
+
+// время на один адрес (time/address, например "12.3n" - наносекунды) и адреса в секунду
+void SetAddressCounters(benchmark::State &state, std::size_t addresses) {
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * addresses));
+    state.counters["time/address"] = benchmark::Counter(static_cast<double>(addresses),
+        benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+}
+
+// время на один запрос (time/query)
+void SetQueryCounters(benchmark::State &state, std::size_t queries) {
+    state.counters["time/query"] = benchmark::Counter(static_cast<double>(queries),
+        benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+}
+
+// Прежний способ загрузки: виртуальный read() и push_back на каждый адрес
+void GetIPAddressesOneByOne(std::vector<IPAddress> &ips, IStream &io) {
+    IPAddress ip;
+    for (;;) {
+        auto result = io.read(ip);
+        if (result == ReadResult::EndOfStream) {
+            break;
+        }
+        if (result == ReadResult::Success) {
+            ips.push_back(ip);
+        }
+    }
+}
+
+// ---- чтение ----
+
+template <typename Stream, bool Batch>
+void BM_Parse(benchmark::State &state) {
+    const std::size_t bytes = MappedFile(Config().path).size();
+    std::size_t count = 0;
+    for (auto _ : state) {
+        std::vector<IPAddress> ips;
+        Stream io(Config().path);
+        if (Batch) {
+            GetIPAddresses(ips, io);
+        } else {
+            GetIPAddressesOneByOne(ips, io);
+        }
+        count = ips.size();
+        benchmark::DoNotOptimize(ips.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+    SetAddressCounters(state, count);
+}
+BENCHMARK_TEMPLATE(BM_Parse, FileStream, false)->Name("Parse/FileStream/read")->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Parse, FileStream, true)->Name("Parse/FileStream/readBatch")->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Parse, MappedFileStream, false)->Name("Parse/MappedFileStream/read")->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Parse, MappedFileStream, true)->Name("Parse/MappedFileStream/readBatch")->Unit(benchmark::kMillisecond);
+
+// разбор одной строки: istringstream и operator>> (прежний путь FileStream) против ParseIPAddress
+const std::vector<std::string> &InputLines() {
+    static const std::vector<std::string> lines = [] {
+        std::vector<std::string> result;
+        std::ifstream in(Config().path);
+        for (std::string line; std::getline(in, line);) {
+            result.push_back(line);
+        }
+        return result;
+    }();
+    return lines;
+}
+
+void BM_ParseLineIostream(benchmark::State &state) {
+    const auto &lines = InputLines();
+    for (auto _ : state) {
+        std::size_t parsed = 0;
+        for (const auto &line : lines) {
+            IPAddress ip;
+            std::istringstream iss(line.substr(0, line.find('\t')));
+            parsed += static_cast<bool>(iss >> ip);
+        }
+        benchmark::DoNotOptimize(parsed);
+    }
+    SetAddressCounters(state, lines.size());
+}
+BENCHMARK(BM_ParseLineIostream)->Name("Parse/Line/istringstream")->Unit(benchmark::kMillisecond);
+
+void BM_ParseLineFromChars(benchmark::State &state) {
+    const auto &lines = InputLines();
+    for (auto _ : state) {
+        std::size_t parsed = 0;
+        for (const auto &line : lines) {
+            IPAddress ip;
+            parsed += ParseIPAddress(line, ip);
+        }
+        benchmark::DoNotOptimize(parsed);
+    }
+    SetAddressCounters(state, lines.size());
+}
+BENCHMARK(BM_ParseLineFromChars)->Name("Parse/Line/ParseIPAddress")->Unit(benchmark::kMillisecond);
+
+// масштабирование параллельного разбора по числу потоков (аргумент)
+void BM_ParseParallel(benchmark::State &state) {
+    const std::size_t bytes = MappedFile(Config().path).size();
+    const auto threads = static_cast<unsigned>(state.range(0));
+    std::size_t count = 0;
+    for (auto _ : state) {
+        std::vector<IPAddress> ips;
+        MappedFileStream io(Config().path);
+        io.readAll(ips, threads);
+        count = ips.size();
+        benchmark::DoNotOptimize(ips.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+    SetAddressCounters(state, count);
+}
+BENCHMARK(BM_ParseParallel)->Name("Parse/MappedFileStream/readAll")->ArgName("threads")
+    ->RangeMultiplier(2)->Range(1, 32)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// ---- сортировка ----
+
+template <SortEngine Engine>
+void BM_Sort(benchmark::State &state) {
+    const auto &ips = InputAddresses();
+    for (auto _ : state) {
+        auto sorted = SortIPAddressesRevers(ips, Engine);
+        benchmark::DoNotOptimize(sorted.data());
+    }
+    SetAddressCounters(state, ips.size());
+}
+BENCHMARK_TEMPLATE(BM_Sort, SortEngine::Comparison)->Name("Sort/Comparison")->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Sort, SortEngine::Radix)->Name("Sort/Radix")->Unit(benchmark::kMillisecond);
+
+void BM_SortParallel(benchmark::State &state) {
+    const auto threads = static_cast<unsigned>(state.range(0));
+    const auto &ips = InputAddresses();
+    for (auto _ : state) {
+        auto sorted = SortIPAddressesReversParallel(ips, threads);
+        benchmark::DoNotOptimize(sorted.data());
+    }
+    SetAddressCounters(state, ips.size());
+}
+BENCHMARK(BM_SortParallel)->Name("Sort/Parallel")->ArgName("threads")
+    ->RangeMultiplier(2)->Range(1, 32)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// ---- фильтры ----
+
+// Запросы first.x.x.x и first.second.x.x: задержка одного запроса важнее
+// стоимости построения индекса, индекс строится один раз и отдельно
+constexpr std::size_t PrefixQueries = 2;
+
+// first.x.x.x и first.second.x.x линейным проходом по отсортированным адресам
+void BM_FilterPrefix(benchmark::State &state) {
+    const auto &sorted = SortedAddresses();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(FilterIPAddresses(sorted, 1).data());
+        benchmark::DoNotOptimize(FilterIPAddresses(sorted, 46, 70).data());
+    }
+    SetQueryCounters(state, PrefixQueries);
+}
+BENCHMARK(BM_FilterPrefix)->Name("Filter/Prefix/Linear");
+
+// те же запросы через готовый индекс: find() и размер диапазона
+void BM_FilterPrefixIndex(benchmark::State &state) {
+    const auto &sorted = SortedAddresses();
+    const PrefixIndex index(sorted);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(index.find(1).size());
+        benchmark::DoNotOptimize(index.find(46, 70).size());
+    }
+    SetQueryCounters(state, PrefixQueries);
+}
+BENCHMARK(BM_FilterPrefixIndex)->Name("Filter/Prefix/PrefixIndex");
+
+// построение индекса префиксов
+void BM_PrefixIndexBuild(benchmark::State &state) {
+    const auto &sorted = SortedAddresses();
+    for (auto _ : state) {
+        PrefixIndex index(sorted);
+        benchmark::DoNotOptimize(index.table());
+    }
+    SetAddressCounters(state, sorted.size());
+}
+BENCHMARK(BM_PrefixIndexBuild)->Name("Filter/Prefix/PrefixIndex/build")->Unit(benchmark::kMillisecond);
+
+// любой октет: скалярный цикл против SSE2/AVX2
+template <SimdLevel Level>
+void BM_FilterAnyOctet(benchmark::State &state) {
+    if (Level > DetectSimdLevel()) {
+        state.SkipWithError("instruction set is not supported by this CPU");
+        return;
+    }
+    const auto &sorted = SortedAddresses();
+    for (auto _ : state) {
+        auto filtered = Level == SimdLevel::Scalar ? FilterIPAddressesAnyOctet(sorted, 46)
+                                                   : FilterIPAddressesAnyOctetSimd(sorted, 46, Level);
+        benchmark::DoNotOptimize(filtered.data());
+    }
+    SetAddressCounters(state, sorted.size());
+}
+BENCHMARK_TEMPLATE(BM_FilterAnyOctet, SimdLevel::Scalar)->Name("Filter/AnyOctet/Scalar");
+BENCHMARK_TEMPLATE(BM_FilterAnyOctet, SimdLevel::SSE2)->Name("Filter/AnyOctet/SSE2");
+BENCHMARK_TEMPLATE(BM_FilterAnyOctet, SimdLevel::AVX2)->Name("Filter/AnyOctet/AVX2");
+
+// 50 правил вперемешку: префиксы, any и CIDR, как в рабочей конфигурации
+RuleSet MixedRules() {
+    RuleSet rules;
+    for (int i = 0; i < 50; ++i) {
+        const auto octet = static_cast<uint8_t>(i * 37 + 1);
+        switch (i % 4) {
+        case 0: rules.add(FilterRule::prefix(octet)); break;
+        case 1: rules.add(FilterRule::prefix(octet, static_cast<uint8_t>(i))); break;
+        case 2: rules.add(FilterRule::anyOctet(octet)); break;
+        default: rules.add(FilterRule::inRange(AddressRange::cidr(IPAddress(octet, static_cast<uint8_t>(i), 0, 0), 12 + i % 12))); break;
+        }
+    }
+    return rules;
+}
+
+// каждое правило отдельным проходом со своим вектором результата
+void BM_RulesSeparate(benchmark::State &state) {
+    const auto &sorted = SortedAddresses();
+    const RuleSet rules = MixedRules();
+    for (auto _ : state) {
+        for (std::size_t id = 0; id < rules.size(); ++id) {
+            const FilterRule &rule = rules[id];
+            std::vector<IPAddress> filtered;
+            if (rule.kind == RuleKind::AnyOctet) {
+                filtered = FilterIPAddressesAnyOctet(sorted, rule.octet, FilterEngine::Simd);
+            } else {
+                std::copy_if(sorted.begin(), sorted.end(), std::back_inserter(filtered),
+                             [&](const IPAddress &ip) { return rule.range.contains(ip); });
+            }
+            benchmark::DoNotOptimize(filtered.data());
+        }
+    }
+    SetAddressCounters(state, sorted.size());
+}
+BENCHMARK(BM_RulesSeparate)->Name("Filter/Rules50/Separate")->Unit(benchmark::kMillisecond);
+
+// все правила за один проход по скомпилированному набору
+void BM_RulesCompiled(benchmark::State &state) {
+    const auto &sorted = SortedAddresses();
+    const CompiledRuleSet compiled = MixedRules().compile();
+    for (auto _ : state) {
+        auto matches = compiled.evaluate(sorted);
+        benchmark::DoNotOptimize(matches.data());
+    }
+    SetAddressCounters(state, sorted.size());
+}
+BENCHMARK(BM_RulesCompiled)->Name("Filter/Rules50/RuleSet")->Unit(benchmark::kMillisecond);
+
+// ---- множества адресов ----
+
+// "список блокировки": половина входа плюс столько же случайных адресов
+const std::vector<IPAddress> &BlocklistAddresses() {
+    static const std::vector<IPAddress> blocklist = [] {
+        const auto &ips = InputAddresses();
+        std::vector<IPAddress> result(ips.begin(), ips.begin() + static_cast<std::ptrdiff_t>(ips.size() / 2));
+        std::mt19937 gen(7);
+        std::uniform_int_distribution<uint32_t> key;
+        for (std::size_t i = 0; i < ips.size() / 2; ++i) {
+            result.push_back(IPAddress::fromKey(key(gen)));
+        }
+        return SortIPAddressesRevers(result, SortEngine::Radix);
+    }();
+    return blocklist;
+}
+
+void BM_SetBuild(benchmark::State &state) {
+    const auto &ips = InputAddresses();
+    for (auto _ : state) {
+        IPBitmap set(ips);
+        benchmark::DoNotOptimize(&set);
+    }
+    SetAddressCounters(state, ips.size());
+}
+BENCHMARK(BM_SetBuild)->Name("Set/IPBitmap/build")->Unit(benchmark::kMillisecond);
+
+// проверка каждого адреса входа: двоичный поиск в отсортированном векторе против IPBitmap
+void BM_SetContainsSorted(benchmark::State &state) {
+    const auto &ips = InputAddresses();
+    const auto &blocklist = BlocklistAddresses();
+    for (auto _ : state) {
+        std::size_t found = 0;
+        for (const auto &ip : ips) {
+            found += std::binary_search(blocklist.begin(), blocklist.end(), ip,
+                                        [](const IPAddress &lhs, const IPAddress &rhs) { return rhs < lhs; });
+        }
+        benchmark::DoNotOptimize(found);
+    }
+    SetAddressCounters(state, ips.size());
+}
+BENCHMARK(BM_SetContainsSorted)->Name("Set/contains/SortedVector")->Unit(benchmark::kMillisecond);
+
+void BM_SetContainsBitmap(benchmark::State &state) {
+    const auto &ips = InputAddresses();
+    const IPBitmap blocklist(BlocklistAddresses());
+    for (auto _ : state) {
+        std::size_t found = 0;
+        for (const auto &ip : ips) {
+            found += blocklist.contains(ip);
+        }
+        benchmark::DoNotOptimize(found);
+    }
+    SetAddressCounters(state, ips.size());
+}
+BENCHMARK(BM_SetContainsBitmap)->Name("Set/contains/IPBitmap")->Unit(benchmark::kMillisecond);
+
+// пересечение с блокировкой: std::set_intersection по отсортированным векторам против IPBitmap
+void BM_SetIntersectSorted(benchmark::State &state) {
+    const auto &sorted = SortedAddresses();
+    const auto &blocklist = BlocklistAddresses();
+    for (auto _ : state) {
+        std::vector<IPAddress> result;
+        std::set_intersection(sorted.begin(), sorted.end(), blocklist.begin(), blocklist.end(), std::back_inserter(result),
+                              [](const IPAddress &lhs, const IPAddress &rhs) { return rhs < lhs; });
+        benchmark::DoNotOptimize(result.data());
+    }
+    SetAddressCounters(state, sorted.size() + blocklist.size());
+}
+BENCHMARK(BM_SetIntersectSorted)->Name("Set/intersect/SortedVector")->Unit(benchmark::kMillisecond);
+
+void BM_SetIntersectBitmap(benchmark::State &state) {
+    const IPBitmap input(InputAddresses());
+    const IPBitmap blocklist(BlocklistAddresses());
+    for (auto _ : state) {
+        IPBitmap result = input & blocklist;
+        benchmark::DoNotOptimize(&result);
+    }
+    SetAddressCounters(state, InputAddresses().size() + BlocklistAddresses().size());
+}
+BENCHMARK(BM_SetIntersectBitmap)->Name("Set/intersect/IPBitmap")->Unit(benchmark::kMillisecond);
+
+// ---- вывод ----
+
+void BM_PrintIostream(benchmark::State &state) {
+    const auto &sorted = SortedAddresses();
+    std::ofstream out("/dev/null");
+    for (auto _ : state) {
+        for (const auto &ip : sorted) {
+            out << ip << "\n";
+        }
+        out.flush();
+    }
+    SetAddressCounters(state, sorted.size());
+}
+BENCHMARK(BM_PrintIostream)->Name("Print/iostream")->Unit(benchmark::kMillisecond);
+
+void BM_PrintWriter(benchmark::State &state) {
+    const auto &sorted = SortedAddresses();
+    std::FILE *out = std::fopen("/dev/null", "w");
+    {
+        IPAddressWriter writer(out);
+        for (auto _ : state) {
+            writer.write(sorted);
+            writer.flush();
+        }
+    }
+    std::fclose(out);
+    SetAddressCounters(state, sorted.size());
+}
+BENCHMARK(BM_PrintWriter)->Name("Print/IPAddressWriter")->Unit(benchmark::kMillisecond);
+
+// ---- весь конвейер, как в main: чтение, сортировка, три фильтра, вывод ----
+
+void BM_Pipeline(benchmark::State &state) {
+    std::FILE *out = std::fopen("/dev/null", "w");
+    std::size_t count = 0;
+    {
+        IPAddressWriter writer(out);
+        for (auto _ : state) {
+            std::vector<IPAddress> ips;
+            MappedFileStream io(Config().path);
+            GetIPAddresses(ips, io);
+            count = ips.size();
+            auto sorted = SortIPAddressesRevers(ips, SortEngine::Radix);
+            writer.write(sorted);
+            writer.write(FilterIPAddresses(sorted, 1));
+            writer.write(FilterIPAddresses(sorted, 46, 70));
+            writer.write(FilterIPAddressesAnyOctet(sorted, 46, FilterEngine::Simd));
+            writer.flush();
+        }
+    }
+    std::fclose(out);
+    SetAddressCounters(state, count);
+}
+BENCHMARK(BM_Pipeline)->Name("Pipeline")->Unit(benchmark::kMillisecond);
+
+int main(int argc, char *argv[]) {
+    // свои флаги разбираем и убираем до передачи остальных в Google Benchmark
+    BenchConfig &config = Config();
+    int kept = 1;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.rfind("--addresses=", 0) == 0) {
+            config.addresses = std::stoul(arg.substr(12));
+        } else if (arg == "--octets=uniform") {
+            config.octets = OctetDistribution::Uniform;
+        } else if (arg == "--octets=skewed") {
+            config.octets = OctetDistribution::Skewed;
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    GenerateInputFile(config);
+    benchmark::AddCustomContext("addresses", std::to_string(config.addresses));
+    benchmark::AddCustomContext("octets", config.octets == OctetDistribution::Skewed ? "skewed" : "uniform");
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    std::remove(config.path.c_str());
+    return 0;
+}
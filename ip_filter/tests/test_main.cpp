@@ -1,7 +1,26 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 #include "ip_filters.h"
+#include "mapped_stream.h"
+#include "simd_filter.h"
+#include "prefix_index.h"
+#include "ip_views.h"
+#include "ip_writer.h"
+#include "range_query.h"
+#include "external_sort.h"
+#include "ip_counter.h"
+#include "snapshot.h"
+#include "pipeline_stats.h"
+#include "rule_set.h"
+#include "ip_bitmap.h"
+#include "follow.h"
+#include <cstddef>
+#include <thread>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <queue>
+#include <random>
 
 // Мок-объект для IStream, сделать чтение из файла.
 class MockIStream : public IStream {
@@ -145,6 +164,879 @@ TEST(IntegrationalTest, FullDataTest) {
     EXPECT_EQ(output.str(), expectedOutputStream.str());
 }
 
+TEST(MappedFileStreamTest, ParseIPLine) {
+    IPAddress ip;
+    std::string line = "113.162.145.156\t111\t0";
+    ASSERT_TRUE(ParseIPLine(line.data(), line.data() + line.size(), ip));
+    EXPECT_EQ(ip, IPAddress(113, 162, 145, 156));
+
+    for (std::string bad : {"", "1.2.3", "1.2.3.256", "1..2.3", "a.b.c.d", "1.2.3\t4"}) {
+        EXPECT_FALSE(ParseIPLine(bad.data(), bad.data() + bad.size(), ip)) << bad;
+    }
+}
+
+TEST(MappedFileStreamTest, SameAsFileStream) {
+    std::vector<IPAddress> expected;
+    FileStream fileStream("ip_filter.tsv");
+    GetIPAddresses(expected, fileStream);
+
+    std::vector<IPAddress> ips;
+    MappedFileStream mappedStream("ip_filter.tsv");
+    GetIPAddresses(ips, mappedStream);
+
+    EXPECT_EQ(ips, expected);
+}
+
+TEST(MappedFileStreamTest, PipeIsReadAsStream) {
+    std::ifstream in("ip_filter.tsv");
+    const std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::vector<IPAddress> expected;
+    FileStream fileStream("ip_filter.tsv");
+    GetIPAddresses(expected, fileStream);
+
+    const std::string path = "ip_filter.fifo";
+    std::remove(path.c_str());
+    ASSERT_EQ(::mkfifo(path.c_str(), 0600), 0);
+    EXPECT_TRUE(IsRegularFile("ip_filter.tsv"));
+    EXPECT_FALSE(IsRegularFile(path));
+
+    // FIFO, как <(zcat ...): размер 0, но данные есть
+    std::thread writer([&] {
+        std::ofstream out(path);
+        out << text;
+    });
+    std::vector<IPAddress> ips;
+    FileStream fifoStream(path);
+    GetIPAddresses(ips, fifoStream);
+    writer.join();
+    EXPECT_EQ(ips, expected);
+    std::remove(path.c_str());
+}
+
+TEST(MappedFileStreamTest, RejectsPipe) {
+    // канал не отображается: readAll по нему вернул бы пустой результат
+    int fds[2];
+    ASSERT_EQ(::pipe(fds), 0);
+    const std::string path = "/proc/self/fd/" + std::to_string(fds[0]);
+    EXPECT_FALSE(IsRegularFile(path));
+    EXPECT_THROW(MappedFileStream{path}, std::runtime_error);
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+TEST(GetIPAddressesTest, ReadsSeveralBatches) {
+    // больше одного пакета, чтобы проверить склейку пакетов
+    const std::size_t total = ReadBatchSize * 2 + 17;
+    std::size_t produced = 0;
+    MockIStream mockStream;
+    EXPECT_CALL(mockStream, read(::testing::_))
+        .WillRepeatedly([&produced, total](IPAddress& ip) -> ReadResult {
+            if (produced == total) {
+                return ReadResult::EndOfStream;
+            }
+            ++produced;
+            // каждая третья строка некорректна
+            if (produced % 3 == 0) {
+                return ReadResult::Failure;
+            }
+            ip = IPAddress(static_cast<uint8_t>(produced >> 8), static_cast<uint8_t>(produced), 0, 0);
+            return ReadResult::Success;
+        });
+
+    std::vector<IPAddress> ips;
+    GetIPAddresses(ips, mockStream);
+
+    ASSERT_EQ(ips.size(), total - total / 3);
+    EXPECT_EQ(ips.front(), IPAddress(0, 1, 0, 0));
+    EXPECT_EQ(ips.back(), IPAddress(static_cast<uint8_t>(total >> 8), static_cast<uint8_t>(total), 0, 0));
+}
+
+TEST(GetIPAddressesTest, BatchSameAsSingleRead) {
+    std::vector<IPAddress> expected;
+    MappedFileStream single("ip_filter.tsv");
+    IPAddress ip;
+    for (ReadResult r; (r = single.read(ip)) != ReadResult::EndOfStream;) {
+        if (r == ReadResult::Success) {
+            expected.push_back(ip);
+        }
+    }
+
+    std::vector<IPAddress> ips;
+    MappedFileStream batch("ip_filter.tsv");
+    GetIPAddresses(ips, batch);
+    EXPECT_EQ(ips, expected);
+    EXPECT_EQ(ips.size(), 1000u);
+}
+
+TEST(SortIPAddressesTest, PackedKey) {
+    IPAddress ip(46, 70, 1, 255);
+    EXPECT_EQ(ip.key(), 0x2E4601FFu);
+    EXPECT_EQ(IPAddress::fromKey(ip.key()), ip);
+    EXPECT_LT(IPAddress(1, 255, 255, 255).key(), IPAddress(2, 0, 0, 0).key());
+}
+
+TEST(SortIPAddressesTest, RadixSameAsComparison) {
+    std::vector<IPAddress> ips;
+    FileStream fileStream("ip_filter.tsv");
+    GetIPAddresses(ips, fileStream);
+
+    EXPECT_EQ(SortIPAddressesRevers(ips, SortEngine::Radix), SortIPAddressesRevers(ips, SortEngine::Comparison));
+    EXPECT_TRUE(SortIPAddressesRevers(std::vector<IPAddress>{}, SortEngine::Radix).empty());
+}
+
+TEST(IntegrationalTest, FullDataRadixTest) {
+    std::ifstream expectedOutputFile("ip_filter_result.tsv");
+    std::vector<IPAddress> ips;
+    MappedFileStream fileStream("ip_filter.tsv");
+    GetIPAddresses(ips, fileStream);
+
+    auto sorted = SortIPAddressesRevers(ips, SortEngine::Radix);
+    std::stringstream output;
+    PrintIPAddresses(sorted, output);
+    PrintIPAddresses(FilterIPAddresses(sorted, 1), output);
+    PrintIPAddresses(FilterIPAddresses(sorted, 46, 70), output);
+    PrintIPAddresses(FilterIPAddressesAnyOctet(sorted, 46), output);
+
+    std::stringstream expectedOutputStream;
+    expectedOutputStream << expectedOutputFile.rdbuf();
+    EXPECT_EQ(output.str(), expectedOutputStream.str());
+}
+
+TEST(SortIPAddressesTest, ParallelSameAsComparison) {
+    std::vector<IPAddress> ips;
+    FileStream fileStream("ip_filter.tsv");
+    GetIPAddresses(ips, fileStream);
+
+    auto expected = SortIPAddressesRevers(ips, SortEngine::Comparison);
+    for (unsigned threads : {1u, 2u, 3u, 8u, 64u}) {
+        EXPECT_EQ(SortIPAddressesReversParallel(ips, threads), expected) << threads;
+    }
+    EXPECT_EQ(SortIPAddressesRevers(ips, SortEngine::Parallel), expected);
+    EXPECT_TRUE(SortIPAddressesReversParallel(std::vector<IPAddress>{}, 4).empty());
+}
+
+TEST(FilterIPAddressesTest, AnyOctetSimdSameAsScalar) {
+    std::vector<IPAddress> ips;
+    FileStream fileStream("ip_filter.tsv");
+    GetIPAddresses(ips, fileStream);
+    // разные длины, чтобы проверить хвост после блоков по 16 адресов
+    for (std::size_t size : {std::size_t{0}, std::size_t{5}, std::size_t{16}, std::size_t{37}, ips.size()}) {
+        std::vector<IPAddress> part(ips.begin(), ips.begin() + size);
+        for (uint8_t octet : {0, 1, 46, 255}) {
+            auto expected = FilterIPAddressesAnyOctet(part, octet);
+            for (auto level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2}) {
+                EXPECT_EQ(FilterIPAddressesAnyOctetSimd(part, octet, level), expected);
+            }
+            EXPECT_EQ(FilterIPAddressesAnyOctet(part, octet, FilterEngine::Simd), expected);
+        }
+    }
+}
+
+TEST(PrefixIndexTest, SameAsFilter) {
+    std::vector<IPAddress> ips;
+    FileStream fileStream("ip_filter.tsv");
+    GetIPAddresses(ips, fileStream);
+    auto sorted = SortIPAddressesRevers(ips, SortEngine::Radix);
+    PrefixIndex index(sorted);
+
+    for (int first = 0; first < 256; ++first) {
+        auto octet = static_cast<uint8_t>(first);
+        EXPECT_EQ(index.find(octet).toVector(), FilterIPAddresses(sorted, octet));
+    }
+    EXPECT_EQ(index.find(46, 70).toVector(), FilterIPAddresses(sorted, 46, 70));
+    // второй октет 0 - тоже конкретное значение, а не "любой"
+    EXPECT_EQ(index.find(46, 0).size(), 0u);
+    EXPECT_EQ(index.find(255, 255).size(), 0u);
+}
+
+TEST(IPViewsTest, LazyFiltersCompose) {
+    std::vector<IPAddress> ips;
+    FileStream fileStream("ip_filter.tsv");
+    GetIPAddresses(ips, fileStream);
+    auto sorted = SortIPAddressesRevers(ips, SortEngine::Radix);
+
+    EXPECT_EQ((sorted | views::FirstOctet(1)).toVector(), FilterIPAddresses(sorted, 1));
+    EXPECT_EQ((sorted | views::Prefix(46, 70)).toVector(), FilterIPAddresses(sorted, 46, 70));
+    EXPECT_EQ((sorted | views::AnyOctet(46)).toVector(), FilterIPAddressesAnyOctet(sorted, 46));
+
+    // сортировка -> префикс -> любой октет, без промежуточных векторов
+    PrefixIndex index(sorted);
+    auto composed = index.find(46) | views::AnyOctet(70) | views::Filter([](const IPAddress &ip) { return ip[3] != 0; });
+    std::vector<IPAddress> expected;
+    for (const auto &ip : FilterIPAddressesAnyOctet(FilterIPAddresses(sorted, 46), 70)) {
+        if (ip[3] != 0) {
+            expected.push_back(ip);
+        }
+    }
+    EXPECT_FALSE(expected.empty());
+    EXPECT_EQ(composed.toVector(), expected);
+    EXPECT_TRUE((sorted | views::Prefix(46, 0)).empty());
+}
+
+TEST(IPAddressWriterTest, SameAsOstream) {
+    std::vector<IPAddress> ips;
+    FileStream fileStream("ip_filter.tsv");
+    GetIPAddresses(ips, fileStream);
+    ips.push_back(IPAddress(0, 0, 0, 0));
+    ips.push_back(IPAddress(255, 255, 255, 255));
+    ips.push_back(IPAddress(9, 10, 99, 100));
+
+    std::stringstream expected;
+    PrintIPAddresses(ips, expected);
+
+    // маленький буфер, чтобы сброс происходил много раз
+    std::FILE *file = std::tmpfile();
+    ASSERT_NE(file, nullptr);
+    {
+        IPAddressWriter writer(file, 100);
+        writer.write(ips);
+    }
+    std::string written(static_cast<std::size_t>(std::ftell(file)), '\0');
+    std::rewind(file);
+    ASSERT_EQ(std::fread(written.data(), 1, written.size(), file), written.size());
+    std::fclose(file);
+
+    EXPECT_EQ(written, expected.str());
+}
+
+TEST(IPAddressWriterTest, FormatStaysInBuffer) {
+    // за буфером FormatIPAddress ничего не пишется даже для самого длинного адреса
+    char out[FormatIPv4BufferSize + 1];
+    out[FormatIPv4BufferSize] = '#';
+    char *end = FormatIPAddress(IPAddress(255, 255, 255, 255), out);
+    EXPECT_EQ(std::string(out, end), "255.255.255.255");
+    EXPECT_EQ(out[FormatIPv4BufferSize], '#');
+}
+
+TEST(RangeQueryTest, ParseRules) {
+    EXPECT_EQ(ParseAddressRange("10.0.0.0/8"), (AddressRange{IPAddress(10, 0, 0, 0).key(), IPAddress(10, 255, 255, 255).key()}));
+    EXPECT_EQ(ParseAddressRange("46.70.1.2/16"), (AddressRange{IPAddress(46, 70, 0, 0).key(), IPAddress(46, 70, 255, 255).key()}));
+    EXPECT_EQ(ParseAddressRange("0.0.0.0/0"), (AddressRange{0, 0xFFFFFFFFu}));
+    EXPECT_EQ(ParseAddressRange("1.2.3.4-1.2.4.0"), (AddressRange{IPAddress(1, 2, 3, 4).key(), IPAddress(1, 2, 4, 0).key()}));
+    EXPECT_EQ(ParseAddressRange("1.2.3.4"), (AddressRange{IPAddress(1, 2, 3, 4).key(), IPAddress(1, 2, 3, 4).key()}));
+
+    for (std::string_view bad : {"", "10.0.0.0/33", "10.0.0.0/", "10.0.0/8", "1.2.3.5-1.2.3.4", "1.2.3.4x", "1.2.3.256",
+                                  "1.2.3.4.5", "10.0.0.0.99/8", "1.2.3.4-1.2.3.9.9", "1.2.3.4.5-1.2.3.9",
+                                  "1..2.3", "1.2.3.", ".1.2.3.4", "1.2.3.+4", "1.2.3.0004"}) {
+        EXPECT_THROW(ParseAddressRange(bad), std::invalid_argument) << bad;
+    }
+}
+
+TEST(RangeQueryTest, FindOnSortedData) {
+    std::vector<IPAddress> ips;
+    FileStream fileStream("ip_filter.tsv");
+    GetIPAddresses(ips, fileStream);
+    auto sorted = SortIPAddressesRevers(ips, SortEngine::Radix);
+
+    EXPECT_EQ(RangeQuery{"1.0.0.0/8"}.filter(sorted), FilterIPAddresses(sorted, 1));
+    EXPECT_EQ(RangeQuery{"46.70.0.0/16"}.filter(sorted), FilterIPAddresses(sorted, 46, 70));
+
+    // пересекающиеся правила объединяются, результат в порядке сортировки без повторов
+    RangeQuery query{"46.70.0.0/16", "1.0.0.0/8", "46.0.0.0/8", "185.0.0.0-185.255.255.255"};
+    EXPECT_EQ(query.ranges().size(), 3u);
+    std::vector<IPAddress> expected;
+    std::copy_if(sorted.begin(), sorted.end(), std::back_inserter(expected), [](const IPAddress &ip) {
+        return ip[0] == 1 || ip[0] == 46 || ip[0] == 185;
+    });
+    EXPECT_EQ(query.filter(sorted), expected);
+    EXPECT_EQ((sorted | views::InRanges(query)).toVector(), expected);
+
+    // 46.0.x.x - то, что нельзя выразить через FilterIPAddresses(sorted, 46, 0)
+    for (const auto &ip : RangeQuery{"46.0.0.0/16"}.filter(sorted)) {
+        EXPECT_EQ(ip[1], 0);
+    }
+    EXPECT_TRUE(RangeQuery().filter(sorted).empty());
+}
+
+TEST(ExternalSortTest, SameAsInMemory) {
+    std::vector<IPAddress> ips;
+    FileStream fileStream("ip_filter.tsv");
+    GetIPAddresses(ips, fileStream);
+    auto expected = SortIPAddressesRevers(ips, SortEngine::Radix);
+
+    // минимальный бюджет: 1000 адресов не помещаются в один кусок
+    for (std::size_t budget : {std::size_t{0}, std::size_t{1} << 20}) {
+        MappedFileStream mappedStream("ip_filter.tsv");
+        auto sorted = ExternalSortIPAddressesRevers(mappedStream, budget);
+        ASSERT_EQ(sorted.size(), expected.size());
+        std::vector<IPAddress> result;
+        sorted.forEach([&result](const IPAddress &ip) { result.push_back(ip); });
+        EXPECT_EQ(result, expected);
+    }
+}
+
+TEST(ExternalSortTest, ManyRunsFewFiles) {
+    // ~50 кусков по 1024 адреса при минимальном бюджете: слияние в несколько проходов
+    const std::string path = "external_sort.tsv";
+    std::vector<IPAddress> ips;
+    {
+        std::mt19937 gen(7);
+        std::ofstream out(path);
+        for (int i = 0; i < 50000; ++i) {
+            IPAddress ip = IPAddress::fromKey(static_cast<uint32_t>(gen()));
+            ips.push_back(ip);
+            out << int(ip[0]) << "." << int(ip[1]) << "." << int(ip[2]) << "." << int(ip[3]) << "\t1\t1\n";
+        }
+    }
+    const auto expected = SortIPAddressesRevers(ips, SortEngine::Radix);
+
+    // лимит дескрипторов не должен зависеть от числа кусков
+    struct rlimit saved;
+    ASSERT_EQ(::getrlimit(RLIMIT_NOFILE, &saved), 0);
+    struct rlimit low = saved;
+    low.rlim_cur = std::min<rlim_t>(saved.rlim_cur, 24);
+    ASSERT_EQ(::setrlimit(RLIMIT_NOFILE, &low), 0);
+    for (std::size_t budget : {std::size_t{0}, std::size_t{64} << 10}) {
+        FileStream fileStream(path);
+        auto sorted = ExternalSortIPAddressesRevers(fileStream, budget);
+        ASSERT_EQ(sorted.size(), expected.size());
+        std::vector<IPAddress> result;
+        sorted.forEach([&result](const IPAddress &ip) { result.push_back(ip); });
+        EXPECT_EQ(result, expected) << budget;
+    }
+    ::setrlimit(RLIMIT_NOFILE, &saved);
+    std::remove(path.c_str());
+}
+
+TEST(ExternalSortTest, TopK) {
+    std::vector<IPAddress> ips;
+    FileStream fileStream("ip_filter.tsv");
+    GetIPAddresses(ips, fileStream);
+    auto sorted = SortIPAddressesRevers(ips, SortEngine::Radix);
+
+    for (std::size_t k : {std::size_t{0}, std::size_t{1}, std::size_t{10}, std::size_t{5000}}) {
+        MappedFileStream mappedStream("ip_filter.tsv");
+        std::vector<IPAddress> expected(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(std::min(k, sorted.size())));
+        EXPECT_EQ(TopIPAddresses(mappedStream, k), expected) << k;
+    }
+}
+
+TEST(IPCounterTest, CountsDuplicates) {
+    IPCounter counter(4);
+    // больше адресов, чем начальная емкость, чтобы таблица росла
+    for (int i = 0; i < 5000; ++i) {
+        counter.add(IPAddress(10, 0, static_cast<uint8_t>(i % 2000 / 256), static_cast<uint8_t>(i % 2000)));
+    }
+    counter.add(IPAddress(1, 2, 3, 4), 7);
+    EXPECT_EQ(counter.unique(), 2001u);
+    EXPECT_EQ(counter.total(), 5007u);
+    EXPECT_EQ(counter.count(IPAddress(10, 0, 0, 0)), 3u);
+    EXPECT_EQ(counter.count(IPAddress(10, 0, 7, 207)), 2u);
+    EXPECT_EQ(counter.count(IPAddress(1, 2, 3, 4)), 7u);
+    EXPECT_EQ(counter.count(IPAddress(1, 2, 3, 5)), 0u);
+}
+
+TEST(IPCounterTest, AggregatedSameAsSorted) {
+    std::vector<IPAddress> ips;
+    FileStream fileStream("ip_filter.tsv");
+    GetIPAddresses(ips, fileStream);
+    auto sorted = SortIPAddressesRevers(ips, SortEngine::Radix);
+
+    IPCounter counter;
+    MappedFileStream mappedStream("ip_filter.tsv");
+    CountIPAddresses(counter, mappedStream);
+    auto aggregated = counter.sortedRevers();
+
+    std::vector<IPAddress> unique = sorted;
+    unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+    EXPECT_EQ(aggregated.ips, unique);
+    EXPECT_EQ(counter.total(), sorted.size());
+    for (const auto &ip : aggregated.ips) {
+        EXPECT_EQ(aggregated.countOf(ip), static_cast<uint64_t>(std::count(sorted.begin(), sorted.end(), ip)));
+    }
+    // копии и отфильтрованные копии адресов ищутся по ключу
+    for (const IPAddress ip : FilterIPAddresses(aggregated.ips, 46, 70)) {
+        EXPECT_EQ(aggregated.countOf(ip), static_cast<uint64_t>(std::count(sorted.begin(), sorted.end(), ip)));
+    }
+    EXPECT_EQ(aggregated.countOf(IPAddress(255, 255, 255, 255)), 0u);
+    EXPECT_EQ(aggregated.countOf(IPAddress(0, 0, 0, 0)), 0u);
+}
+
+TEST(MappedFileStreamTest, ParallelReadAllSameAsSequential) {
+    // файл побольше, чтобы он делился на несколько кусков
+    const std::string path = "parallel_parse.tsv";
+    {
+        std::ofstream out(path);
+        std::ifstream in("ip_filter.tsv");
+        std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        for (int i = 0; i < 20; ++i) {
+            out << text << "bad line\n";
+        }
+        // последняя строка без перевода строки
+        out << "1.2.3.4";
+    }
+    std::vector<IPAddress> expected;
+    FileStream fileStream(path);
+    GetIPAddresses(expected, fileStream);
+
+    for (unsigned threads : {1u, 2u, 3u, 7u, 16u}) {
+        std::vector<IPAddress> ips;
+        MappedFileStream mappedStream(path);
+        mappedStream.readAll(ips, threads);
+        EXPECT_EQ(ips, expected) << threads;
+        IPAddress ip;
+        EXPECT_EQ(mappedStream.read(ip), ReadResult::EndOfStream);
+    }
+    std::remove(path.c_str());
+}
+
+TEST(SnapshotTest, WriteAndMap) {
+    std::vector<IPAddress> ips;
+    FileStream fileStream("ip_filter.tsv");
+    GetIPAddresses(ips, fileStream);
+    auto sorted = SortIPAddressesRevers(ips, SortEngine::Radix);
+
+    for (bool withIndex : {true, false}) {
+        const std::string path = "ip_filter.snapshot";
+        WriteSnapshot(path, sorted, withIndex);
+        {
+            Snapshot snapshot(path);
+            EXPECT_EQ(snapshot.hasIndex(), withIndex);
+            EXPECT_EQ(snapshot.addresses().toVector(), sorted);
+            auto index = snapshot.index();
+            EXPECT_EQ(index.find(1).toVector(), FilterIPAddresses(sorted, 1));
+            EXPECT_EQ(index.find(46, 70).toVector(), FilterIPAddresses(sorted, 46, 70));
+
+            // существующие функции поверх потока из снимка
+            std::vector<IPAddress> loaded;
+            SnapshotStream stream(path);
+            GetIPAddresses(loaded, stream);
+            EXPECT_EQ(FilterIPAddressesAnyOctet(loaded, 46), FilterIPAddressesAnyOctet(sorted, 46));
+        }
+        std::remove(path.c_str());
+    }
+    EXPECT_THROW(Snapshot("ip_filter.tsv"), std::runtime_error);
+}
+
+TEST(SnapshotTest, CorruptedIndexTable) {
+    std::vector<IPAddress> ips;
+    FileStream fileStream("ip_filter.tsv");
+    GetIPAddresses(ips, fileStream);
+    const auto sorted = SortIPAddressesRevers(ips, SortEngine::Radix);
+    const std::string path = "ip_filter_corrupted.snapshot";
+
+    // заново записать снимок и испортить значения по смещениям от начала файла
+    auto patch = [&](std::initializer_list<std::pair<uint64_t, uint64_t>> values) {
+        WriteSnapshot(path, sorted, true);
+        std::FILE *file = std::fopen(path.c_str(), "r+b");
+        ASSERT_NE(file, nullptr);
+        for (auto [offset, value] : values) {
+            std::fseek(file, static_cast<long>(offset), SEEK_SET);
+            std::fwrite(&value, sizeof(value), 1, file);
+        }
+        std::fclose(file);
+    };
+    // смещение k-го элемента таблицы индекса
+    const uint64_t indexOffset = (sizeof(SnapshotHeader) + sorted.size() * sizeof(IPAddress) + 7) / 8 * 8;
+    auto index = [&](uint64_t k) { return indexOffset + k * sizeof(uint64_t); };
+
+    patch({});
+    EXPECT_NO_THROW(Snapshot{path});
+
+    // смещения внутри таблицы убывают и выходят за число адресов
+    patch({{index(65024), 0}, {index(65280), 10000000}});
+    EXPECT_THROW(Snapshot{path}, std::runtime_error);
+
+    // таблица начинается не с нуля
+    patch({{index(0), 1}});
+    EXPECT_THROW(Snapshot{path}, std::runtime_error);
+
+    // последнее смещение не равно числу адресов
+    patch({{index(PrefixIndex::TableSize), sorted.size() - 1}});
+    EXPECT_THROW(Snapshot{path}, std::runtime_error);
+
+    // смещение таблицы, при котором сложение с ее размером переполняется
+    patch({{offsetof(SnapshotHeader, indexOffset), ~uint64_t{7}}});
+    EXPECT_THROW(Snapshot{path}, std::runtime_error);
+
+    std::remove(path.c_str());
+}
+
+
+TEST(IPv6Test, ParseAndFormat) {
+    std::array<uint8_t, 16> bytes;
+    ASSERT_TRUE(ParseIPv6("2001:DB8:0:0:1:0:0:1", bytes));
+    auto ip = IPv6Address::fromBytes(bytes);
+    EXPECT_EQ(ip[0], 0x20);
+    EXPECT_EQ(ip[1], 0x01);
+    EXPECT_EQ(ip[15], 0x01);
+
+    // RFC 5952: строчные цифры, "::" на первой из самых длинных серий нулей
+    auto format = [](const std::string &text) {
+        std::array<uint8_t, 16> b;
+        EXPECT_TRUE(ParseIPv6(text, b)) << text;
+        char out[40];
+        return std::string(out, FormatIPv6(b, out));
+    };
+    EXPECT_EQ(format("2001:DB8:0:0:1:0:0:1"), "2001:db8::1:0:0:1");
+    EXPECT_EQ(format("2001:0db8:0000:0000:0000:0000:0002:0001"), "2001:db8::2:1");
+    EXPECT_EQ(format("2001:db8:0:1:1:1:1:1"), "2001:db8:0:1:1:1:1:1");
+    EXPECT_EQ(format("::"), "::");
+    EXPECT_EQ(format("::1"), "::1");
+    EXPECT_EQ(format("fe80::"), "fe80::");
+    EXPECT_EQ(format("::ffff:10.0.0.1"), "::ffff:a00:1");
+
+    for (const char *bad : {"", ":", "1::2::3", "1:2:3:4:5:6:7", "1:2:3:4:5:6:7:8:9", "12345::", "g::", "::1.2.3.256"}) {
+        EXPECT_FALSE(ParseIPv6(bad, bytes)) << bad;
+    }
+
+    std::istringstream in("2001:db8::1\t5\t6");
+    IPv6Address read;
+    ASSERT_TRUE(in >> read);
+    std::ostringstream out;
+    out << read;
+    EXPECT_EQ(out.str(), "2001:db8::1");
+}
+
+TEST(IPv6Test, SortAndFilterSameAsIPv4Pipeline) {
+    std::mt19937 gen(6);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<IPv6Address> ips(3001);
+    for (auto &ip : ips) {
+        std::array<uint8_t, 16> bytes;
+        for (auto &b : bytes) {
+            // узкий диапазон, чтобы были совпадения и дубликаты
+            b = static_cast<uint8_t>(byte(gen) % 4 == 0 ? 46 : byte(gen) % 3);
+        }
+        ip = IPv6Address::fromBytes(bytes);
+    }
+
+    auto expected = ips;
+    std::sort(expected.begin(), expected.end(), [](const IPv6Address &lhs, const IPv6Address &rhs) {
+        return lhs.bytes() > rhs.bytes();
+    });
+    EXPECT_EQ(SortIPAddressesRevers(ips), expected);
+    EXPECT_EQ(SortIPAddressesRevers(ips, SortEngine::Radix), expected);
+    EXPECT_EQ(SortIPAddressesReversParallel(ips, 4), expected);
+    EXPECT_EQ(IPv6Address::fromKey(expected.front().key()), expected.front());
+
+    const auto scalar = FilterIPAddressesAnyOctet(ips, 46);
+    EXPECT_FALSE(scalar.empty());
+    EXPECT_EQ(FilterIPAddressesAnyOctetSimd(ips, 46, SimdLevel::SSE2), scalar);
+    EXPECT_EQ(FilterIPAddressesAnyOctetSimd(ips, 46, SimdLevel::AVX2), scalar);
+    for (const auto &ip : FilterIPAddresses(ips, 46, 1)) {
+        EXPECT_EQ(ip[0], 46);
+        EXPECT_EQ(ip[1], 1);
+    }
+}
+
+TEST(ReadStatsTest, CountsRejectedLines) {
+    const std::string path = "read_stats.tsv";
+    const std::string text = "1.2.3.4\tx\n\nbad line\n256.1.1.1\n46.70.1.2\t1\t2\n5.6.7.8";
+    {
+        std::ofstream out(path);
+        out << text;
+    }
+    auto check = [&](const ReadStats &stats, const char *name) {
+        EXPECT_EQ(stats.lines, 6u) << name;
+        EXPECT_EQ(stats.rejected, 3u) << name;
+        EXPECT_EQ(stats.accepted(), 3u) << name;
+    };
+
+    std::vector<IPAddress> ips;
+    FileStream fileStream(path);
+    GetIPAddresses(ips, fileStream);
+    EXPECT_EQ(ips.size(), 3u);
+    check(fileStream.stats(), "FileStream");
+    // у последней строки нет перевода строки, но он считается
+    EXPECT_EQ(fileStream.stats().bytes, text.size() + 1);
+
+    MappedFileStream mappedStream(path);
+    IPAddress ip;
+    while (mappedStream.read(ip) != ReadResult::EndOfStream) {
+    }
+    check(mappedStream.stats(), "MappedFileStream::read");
+    EXPECT_EQ(mappedStream.stats().bytes, text.size());
+
+    std::vector<IPAddress> all;
+    MappedFileStream parallelStream(path);
+    parallelStream.readAll(all, 4);
+    check(parallelStream.stats(), "MappedFileStream::readAll");
+
+    // поток только с read(): строки считает readBatch по умолчанию
+    MockIStream mock;
+    EXPECT_CALL(mock, read(testing::_))
+        .WillOnce(testing::Return(ReadResult::Success))
+        .WillOnce(testing::Return(ReadResult::Failure))
+        .WillRepeatedly(testing::Return(ReadResult::EndOfStream));
+    std::vector<IPAddress> mocked;
+    GetIPAddresses(mocked, mock);
+    EXPECT_EQ(mock.stats().lines, 2u);
+    EXPECT_EQ(mock.stats().rejected, 1u);
+    std::remove(path.c_str());
+}
+
+TEST(PipelineStatsTest, ReportIsJson) {
+    PipelineStats stats;
+    stats.measure("read", [] {});
+    stats.measure("sort", [] {});
+    ASSERT_EQ(stats.stageTimes().size(), 2u);
+    EXPECT_EQ(stats.stageTimes()[1].first, "sort");
+
+    ReadStats read;
+    read.lines = 10;
+    read.rejected = 2;
+    read.bytes = 100;
+    std::FILE *out = std::tmpfile();
+    stats.report(out, "in-memory", read);
+    std::rewind(out);
+    char buffer[512] = {};
+    std::fread(buffer, 1, sizeof(buffer) - 1, out);
+    std::fclose(out);
+
+    const std::string json = buffer;
+    EXPECT_EQ(json.rfind("{\"mode\":\"in-memory\",\"stages\":{\"read\":", 0), 0u) << json;
+    EXPECT_NE(json.find("\"lines\":{\"read\":10,\"accepted\":8,\"rejected\":2},\"bytes\":100,"), std::string::npos) << json;
+    EXPECT_NE(json.find("\"peak_rss_bytes\":"), std::string::npos) << json;
+    EXPECT_GT(PeakRSSBytes(), 0u);
+}
+
+
+TEST(RuleSetTest, ParseRules) {
+    EXPECT_EQ(ParseFilterRule("prefix 46").range, (AddressRange{0x2E000000, 0x2EFFFFFF}));
+    EXPECT_EQ(ParseFilterRule("  prefix 46.70 ").range, (AddressRange{0x2E460000, 0x2E46FFFF}));
+    EXPECT_EQ(ParseFilterRule("any 46").kind, RuleKind::AnyOctet);
+    EXPECT_EQ(ParseFilterRule("range 10.0.0.0/8").range, ParseAddressRange("10.0.0.0/8"));
+    for (const char *bad : {"", "prefix", "prefix 256", "prefix 1.2.3", "any x", "range 1.2.3", "cidr 10.0.0.0/8"}) {
+        EXPECT_THROW(ParseFilterRule(bad), std::invalid_argument) << bad;
+    }
+}
+
+TEST(RuleSetTest, SinglePassSameAsSeparateFilters) {
+    std::vector<IPAddress> ips;
+    FileStream fileStream("ip_filter.tsv");
+    GetIPAddresses(ips, fileStream);
+    // повторы октетов внутри адреса и диапазоны на границах блоков first.second
+    ips.push_back(IPAddress(46, 46, 46, 46));
+    ips.push_back(IPAddress(1, 46, 46, 1));
+    ips.push_back(IPAddress(10, 0, 255, 255));
+    ips.push_back(IPAddress(10, 1, 0, 0));
+    auto sorted = SortIPAddressesRevers(ips, SortEngine::Radix);
+
+    RuleSet rules{"prefix 1", "prefix 46.70", "any 46", "any 1", "range 10.0.0.0/8",
+                  "range 10.0.200.0-10.1.0.0", "range 185.46.85.0/24", "range 0.0.0.0/0", "prefix 0.0"};
+    const auto matches = rules.compile().evaluate(sorted);
+    ASSERT_EQ(matches.size(), rules.size());
+
+    EXPECT_EQ(matches[0], FilterIPAddresses(sorted, 1));
+    EXPECT_EQ(matches[1], FilterIPAddresses(sorted, 46, 70));
+    EXPECT_EQ(matches[2], FilterIPAddressesAnyOctet(sorted, 46));
+    EXPECT_EQ(matches[3], FilterIPAddressesAnyOctet(sorted, 1));
+    EXPECT_EQ(matches[7], sorted);
+    for (std::size_t id = 0; id < rules.size(); ++id) {
+        std::vector<IPAddress> expected;
+        std::copy_if(sorted.begin(), sorted.end(), std::back_inserter(expected),
+                     [&](const IPAddress &ip) { return rules[id].matches(ip); });
+        EXPECT_EQ(matches[id], expected) << id;
+    }
+    EXPECT_FALSE(matches[5].empty());
+}
+
+
+TEST(IPBitmapTest, SetOperationsSameAsSortedVectors) {
+    // плотный блок 10.0.x.x (битовая карта) и разреженные адреса (массивы)
+    std::mt19937 gen(18);
+    auto makeSet = [&](std::size_t dense, std::size_t sparse) {
+        std::uniform_int_distribution<uint32_t> low(0, 0xFFFF);
+        std::uniform_int_distribution<uint32_t> any;
+        std::vector<IPAddress> ips;
+        for (std::size_t i = 0; i < dense; ++i) {
+            ips.push_back(IPAddress::fromKey(0x0A000000 | low(gen)));
+        }
+        for (std::size_t i = 0; i < sparse; ++i) {
+            ips.push_back(IPAddress::fromKey(any(gen) & 0x0F0FFFFF));
+        }
+        return ips;
+    };
+    auto sortedUnique = [](std::vector<IPAddress> ips) {
+        ips = SortIPAddressesRevers(ips, SortEngine::Radix);
+        ips.erase(std::unique(ips.begin(), ips.end()), ips.end());
+        return ips;
+    };
+    auto descending = [](const IPAddress &lhs, const IPAddress &rhs) { return rhs < lhs; };
+
+    const auto a = makeSet(20000, 3000);
+    const auto b = makeSet(3000, 3000);
+    const IPBitmap setA(a);
+    const IPBitmap setB(b);
+    const auto sortedA = sortedUnique(a);
+    const auto sortedB = sortedUnique(b);
+
+    EXPECT_EQ(setA.size(), sortedA.size());
+    EXPECT_EQ(setA.toVector(), sortedA);
+    for (const auto &ip : b) {
+        EXPECT_EQ(setA.contains(ip), std::binary_search(sortedA.begin(), sortedA.end(), ip, descending));
+    }
+
+    std::vector<IPAddress> expected;
+    std::set_union(sortedA.begin(), sortedA.end(), sortedB.begin(), sortedB.end(), std::back_inserter(expected), descending);
+    EXPECT_EQ((setA | setB).toVector(), expected);
+    expected.clear();
+    std::set_intersection(sortedA.begin(), sortedA.end(), sortedB.begin(), sortedB.end(), std::back_inserter(expected), descending);
+    EXPECT_EQ((setA & setB).toVector(), expected);
+    expected.clear();
+    std::set_difference(sortedA.begin(), sortedA.end(), sortedB.begin(), sortedB.end(), std::back_inserter(expected), descending);
+    EXPECT_EQ((setA - setB).toVector(), expected);
+    expected.clear();
+    std::set_difference(sortedB.begin(), sortedB.end(), sortedA.begin(), sortedA.end(), std::back_inserter(expected), descending);
+    EXPECT_EQ((setB - setA).toVector(), expected);
+
+    EXPECT_TRUE((setA - setA).empty());
+    EXPECT_EQ(setA & setA, setA);
+    EXPECT_EQ(setA | IPBitmap(), setA);
+
+    // поштучное добавление дает то же представление, что и построение из вектора
+    IPBitmap added;
+    for (const auto &ip : b) {
+        added.add(ip);
+    }
+    EXPECT_EQ(added, setB);
+}
+
+
+TEST(FollowTest, ReadsOnlyAppendedLines) {
+    const std::string path = "follow.tsv";
+    std::remove(path.c_str());
+    std::FILE *out = std::fopen(path.c_str(), "w");
+    ASSERT_NE(out, nullptr);
+    std::fputs("1.2.3.4\tx\nbad\n46.70.", out);
+    std::fflush(out);
+
+    LogFollower follower(path);
+    std::vector<IPAddress> ips;
+    EXPECT_EQ(follower.poll(ips), 1u);
+    EXPECT_EQ(follower.poll(ips), 0u);
+    // недописанная строка дописана
+    std::fputs("1.2\t1\n5.6.7.8\n", out);
+    std::fflush(out);
+    EXPECT_EQ(follower.poll(ips), 2u);
+    EXPECT_EQ(ips, (std::vector<IPAddress>{IPAddress(1, 2, 3, 4), IPAddress(46, 70, 1, 2), IPAddress(5, 6, 7, 8)}));
+    EXPECT_EQ(follower.stats().lines, 4u);
+    EXPECT_EQ(follower.stats().rejected, 1u);
+    std::fclose(out);
+
+    // усечение: чтение с начала
+    out = std::fopen(path.c_str(), "w");
+    std::fputs("9.9.9.9\n", out);
+    std::fclose(out);
+    ips.clear();
+    EXPECT_EQ(follower.poll(ips), 1u);
+    EXPECT_EQ(ips.front(), IPAddress(9, 9, 9, 9));
+
+    // ротация переименованием: старый файл дочитывается, новый читается с начала
+    out = std::fopen(path.c_str(), "a");
+    std::fputs("8.8.8.8\n", out);
+    std::fclose(out);
+    std::rename(path.c_str(), "follow.tsv.1");
+    out = std::fopen(path.c_str(), "w");
+    std::fputs("7.7.7.7\n", out);
+    std::fclose(out);
+    ips.clear();
+    EXPECT_EQ(follower.poll(ips), 2u);
+    EXPECT_EQ(ips, (std::vector<IPAddress>{IPAddress(8, 8, 8, 8), IPAddress(7, 7, 7, 7)}));
+    std::remove(path.c_str());
+    std::remove("follow.tsv.1");
+}
+
+TEST(FollowTest, RotationKeepsUnterminatedLastLine) {
+    const std::string path = "follow_rotate.tsv";
+    std::FILE *out = std::fopen(path.c_str(), "w");
+    ASSERT_NE(out, nullptr);
+    std::fputs("1.1.1.1\n2.2.", out);
+    std::fclose(out);
+
+    LogFollower follower(path);
+    std::vector<IPAddress> ips;
+    EXPECT_EQ(follower.poll(ips), 1u);
+    // старый файл дописан без перевода строки и заменен новым
+    out = std::fopen(path.c_str(), "a");
+    std::fputs("2.2\tx", out);
+    std::fclose(out);
+    std::rename(path.c_str(), "follow_rotate.tsv.1");
+    out = std::fopen(path.c_str(), "w");
+    std::fputs("3.3.3.3\n", out);
+    std::fclose(out);
+    EXPECT_EQ(follower.poll(ips), 2u);
+    EXPECT_EQ(ips, (std::vector<IPAddress>{IPAddress(1, 1, 1, 1), IPAddress(2, 2, 2, 2), IPAddress(3, 3, 3, 3)}));
+    EXPECT_EQ(follower.stats().lines, 3u);
+    EXPECT_EQ(follower.stats().rejected, 0u);
+    std::remove(path.c_str());
+    std::remove("follow_rotate.tsv.1");
+}
+
+TEST(FollowTest, IncrementalSameAsFullRun) {
+    std::vector<IPAddress> ips;
+    FileStream fileStream("ip_filter.tsv");
+    GetIPAddresses(ips, fileStream);
+
+    RuleSet rules{"prefix 1", "prefix 46.70", "any 46"};
+    IncrementalResults results(rules.compile());
+    // порции разного размера, снимок посередине
+    const std::size_t half = ips.size() / 2;
+    for (std::size_t first = 0, size = 1; first < ips.size(); first += size, size = size * 3 % 97 + 1) {
+        const auto last = ips.begin() + static_cast<std::ptrdiff_t>(std::min(ips.size(), first + size));
+        results.add(std::vector<IPAddress>(ips.begin() + static_cast<std::ptrdiff_t>(first), last));
+        if (first < half && first + size >= half) {
+            const auto prefix = SortIPAddressesRevers(std::vector<IPAddress>(ips.begin(), last));
+            EXPECT_EQ(results.sorted(), prefix);
+            EXPECT_EQ(results.ruleMatches(1), FilterIPAddresses(prefix, 46, 70));
+        }
+    }
+
+    const auto sorted = SortIPAddressesRevers(ips);
+    EXPECT_EQ(results.sorted(), sorted);
+    ASSERT_EQ(results.ruleCount(), 3u);
+    EXPECT_EQ(results.ruleMatches(0), FilterIPAddresses(sorted, 1));
+    EXPECT_EQ(results.ruleMatches(1), FilterIPAddresses(sorted, 46, 70));
+    EXPECT_EQ(results.ruleMatches(2), FilterIPAddressesAnyOctet(sorted, 46));
+}
+
+TEST(FollowTest, SortedRunsMergeLazily) {
+    SortedRuns runs;
+    std::vector<IPAddress> expected;
+    for (int i = 0; i < 100; ++i) {
+        std::vector<IPAddress> batch{IPAddress(i % 7, i, 0, 1), IPAddress(i % 7, i, 0, 0)};
+        expected.insert(expected.end(), batch.begin(), batch.end());
+        runs.add(batch);
+        runs.add({});
+        if (i % 37 == 0) {
+            EXPECT_EQ(runs.sorted(), SortIPAddressesRevers(expected));
+        }
+    }
+    EXPECT_EQ(runs.sorted(), SortIPAddressesRevers(expected));
+    EXPECT_EQ(runs.sorted(), SortIPAddressesRevers(expected));
+}
+
+
+TEST(ParseIPAddressTest, SameAsStreamOperator) {
+    IPAddress ip;
+    ASSERT_TRUE(ParseIPAddress("  113.162.145.156\t111\t0", ip));
+    EXPECT_EQ(ip, IPAddress(113, 162, 145, 156));
+    ASSERT_TRUE(ParseIPAddress("001.02.0.255\r", ip));
+    EXPECT_EQ(ip, IPAddress(1, 2, 0, 255));
+    for (std::string_view bad : {"", " ", "1.2.3", "1.2.3.256", "1..2.3", "a.b.c.d", "1.2.3\t4", "-1.2.3.4",
+                                 "+1.2.3.4", "1.2.3.99999999999999999999", "1.2.3.0004", "\t1.2.3.4"}) {
+        EXPECT_FALSE(ParseIPAddress(bad, ip)) << bad;
+    }
+
+    // на корректных строках совпадает с operator>>
+    std::ifstream in("ip_filter.tsv");
+    std::string line;
+    while (std::getline(in, line)) {
+        IPAddress expected;
+        std::istringstream iss(line.substr(0, line.find('\t')));
+        ASSERT_TRUE(iss >> expected);
+        ASSERT_TRUE(ParseIPAddress(line, ip)) << line;
+        EXPECT_EQ(ip, expected);
+    }
+
+    IPv6Address ip6;
+    ASSERT_TRUE(ParseIPAddress(" 2001:db8::1\t1\t2", ip6));
+    EXPECT_EQ(ip6[0], 0x20);
+    EXPECT_EQ(ip6[15], 0x01);
+    EXPECT_FALSE(ParseIPAddress("2001:db8::1x\t1", ip6));
+}
+
 
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);